@@ -0,0 +1,169 @@
+/*********************************************************************
+*
+* daq_sim:
+*    Software stand-in for the DAQmx Base AI calls used by
+*    nidaqAnalog6221, for throughput benchmarks without a board.
+*
+*    Samples appear in real time at the configured rate. Reads block
+*    until enough are there (or time out), and a buffer that is not
+*    read fast enough overflows with the same error code as DAQmx
+*    Base, so the node's overrun recovery is exercised too.
+*
+*********************************************************************/
+
+#include <NIDAQmxBase.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "nidaq/channels.h"
+
+#define SIM_ERROR_OVERRUN   -200279
+#define SIM_ERROR_TIMEOUT   -200284
+#define SIM_ERROR_TASK      -200088
+#define SIM_TABLE           1024
+
+struct SimTask {
+    int         channels;
+    float64     rate;
+    uInt32      bufferSize;
+    bool        running;
+    uInt64      startNs;
+    uInt64      consumed;       // samples per channel handed out since start
+};
+
+static char     lastError[256] = "";
+static float64  table[SIM_TABLE];
+static bool     tableReady = false;
+
+static uInt64 nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uInt64)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+static uInt64 produced(const SimTask* task)
+{
+    return (uInt64)((nowNs() - task->startNs) * 1e-9 * task->rate);
+}
+
+static int32 fail(int32 code, const char* text)
+{
+    snprintf(lastError, sizeof(lastError), "daq_sim: %s", text);
+    return code;
+}
+
+extern "C" {
+
+int32 DAQmxBaseCreateTask(const char taskName[], TaskHandle *taskHandle)
+{
+    SimTask *task = new SimTask;
+    memset(task, 0, sizeof(*task));
+    task->rate = 1000;
+    task->bufferSize = 1000;
+    *taskHandle = (TaskHandle)task;
+    if(!tableReady){
+        for(int i = 0; i < SIM_TABLE; i++)
+            table[i] = 5.0*sin(i*2.0*3.1415926535/SIM_TABLE);
+        tableReady = true;
+    }
+    return 0;
+}
+
+int32 DAQmxBaseCreateAIVoltageChan(TaskHandle taskHandle, const char physicalChannel[], const char nameToAssignToChannel[], int32 terminalConfig, float64 minVal, float64 maxVal, int32 units, const char customScaleName[])
+{
+    ((SimTask *)taskHandle)->channels += nidaq::countChannels(physicalChannel);
+    return 0;
+}
+
+int32 DAQmxBaseCfgSampClkTiming(TaskHandle taskHandle, const char source[], float64 rate, int32 activeEdge, int32 sampleMode, uInt64 sampsPerChan)
+{
+    ((SimTask *)taskHandle)->rate = rate;
+    return 0;
+}
+
+int32 DAQmxBaseCfgInputBuffer(TaskHandle taskHandle, uInt32 numSampsPerChan)
+{
+    ((SimTask *)taskHandle)->bufferSize = numSampsPerChan;
+    return 0;
+}
+
+int32 DAQmxBaseStartTask(TaskHandle taskHandle)
+{
+    SimTask *task = (SimTask *)taskHandle;
+    task->running = true;
+    task->startNs = nowNs();
+    task->consumed = 0;
+    return 0;
+}
+
+int32 DAQmxBaseStopTask(TaskHandle taskHandle)
+{
+    ((SimTask *)taskHandle)->running = false;
+    return 0;
+}
+
+int32 DAQmxBaseClearTask(TaskHandle taskHandle)
+{
+    delete (SimTask *)taskHandle;
+    return 0;
+}
+
+int32 DAQmxBaseIsTaskDone(TaskHandle taskHandle, bool32 *isTaskDone)
+{
+    *isTaskDone = !((SimTask *)taskHandle)->running;
+    return 0;
+}
+
+int32 DAQmxBaseGetReadAttribute(TaskHandle taskHandle, int32 attribute, void *value)
+{
+    SimTask *task = (SimTask *)taskHandle;
+    if(attribute != DAQmx_Read_AvailSampPerChan)
+        return fail(SIM_ERROR_TASK, "attribute not simulated");
+    *(uInt32 *)value = (uInt32)(produced(task) - task->consumed);
+    return 0;
+}
+
+int32 DAQmxBaseReadAnalogF64(TaskHandle taskHandle, int32 numSampsPerChan, float64 timeout, bool32 fillMode, float64 readArray[], uInt32 arraySizeInSamps, int32 *sampsPerChanRead, bool32 *reserved)
+{
+    SimTask *task = (SimTask *)taskHandle;
+    uInt64 deadline = nowNs() + (uInt64)(timeout*1e9);
+
+    *sampsPerChanRead = 0;
+    if(!task->running)
+        return fail(SIM_ERROR_TASK, "task not running");
+    if((uInt32)(numSampsPerChan*task->channels) > arraySizeInSamps)
+        return fail(SIM_ERROR_TASK, "read array too small");
+
+    if(produced(task) - task->consumed > task->bufferSize)
+        return fail(SIM_ERROR_OVERRUN, "input buffer overwritten");
+
+    // sleep until the last requested sample has been "acquired"
+    uInt64 ready = task->startNs + (uInt64)((task->consumed + numSampsPerChan) / task->rate * 1e9);
+    if(ready > deadline)
+        ready = deadline;
+    struct timespec ts;
+    ts.tv_sec = ready / 1000000000ULL;
+    ts.tv_nsec = ready % 1000000000ULL;
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    if(produced(task) < task->consumed + numSampsPerChan)
+        return fail(SIM_ERROR_TIMEOUT, "samples not yet available");
+
+    for(int32 s = 0; s < numSampsPerChan; s++){
+        uInt64 index = task->consumed + s;
+        for(int c = 0; c < task->channels; c++)
+            readArray[s*task->channels + c] = table[(index + c*37) % SIM_TABLE];
+    }
+    task->consumed += numSampsPerChan;
+    *sampsPerChanRead = numSampsPerChan;
+    return 0;
+}
+
+int32 DAQmxBaseGetExtendedErrorInfo(char errorString[], uInt32 bufferSize)
+{
+    snprintf(errorString, bufferSize, "%s", lastError);
+    return 0;
+}
+
+}
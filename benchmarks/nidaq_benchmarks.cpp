@@ -0,0 +1,207 @@
+/*********************************************************************
+*
+* nidaq_benchmarks:
+*    Microbenchmarks of the kernels on the nodes' hot paths.
+*
+*    Results are machine readable with
+*        nidaq_benchmarks --benchmark_format=json --benchmark_out=out.json
+*    and two runs compare with Google Benchmark's tools/compare.py.
+*
+*********************************************************************/
+
+#include <benchmark/benchmark.h>
+#include <math.h>
+#include <vector>
+#include "nidaq/kernels.h"
+#include "nidaq/simd_kernels.h"
+#include "nidaq/shape_kernels.h"
+#include "nidaq/ring_buffer.h"
+#include "nidaq/channel_filter.h"
+
+#define PI	3.1415926535
+
+// AO sine buffer, as built once by nidaqAO6221 / Modified6221
+static void BM_FillSine(benchmark::State& state)
+{
+    std::vector<double> data(state.range(0));
+    for(auto _ : state){
+        nidaq::fillSine(&data[0], data.size(), 2.5);
+        benchmark::DoNotOptimize(&data[0]);
+    }
+    state.SetItemsProcessed(state.iterations()*data.size());
+}
+BENCHMARK(BM_FillSine)->Arg(512)->Arg(4096);
+
+// Amplitude law, the way Modified6221 used to do it: sin() per sample
+static void BM_AmplitudeLawSin(benchmark::State& state)
+{
+    std::vector<double> data(state.range(0));
+    double ai0 = 1.0;
+    for(auto _ : state){
+        for(size_t i = 0; i < data.size(); i++)
+            data[i] = 2.5*((ai0 - 0.0)/(3.3 - 0.0))*sin((double)i*2.0*PI/(double)data.size());
+        benchmark::DoNotOptimize(&data[0]);
+        ai0 += 1e-6;
+    }
+    state.SetItemsProcessed(state.iterations()*data.size());
+}
+BENCHMARK(BM_AmplitudeLawSin)->Arg(512);
+
+// Amplitude law on a precomputed unit sine
+static void BM_AmplitudeLaw(benchmark::State& state)
+{
+    std::vector<double> unit(state.range(0)), data(state.range(0));
+    double ai0 = 1.0;
+    nidaq::fillSine(&unit[0], unit.size(), 1.0);
+    for(auto _ : state){
+        nidaq::amplitudeLaw(&unit[0], data.size(), ai0, 0.0, 3.3, 2.5, &data[0]);
+        benchmark::DoNotOptimize(&data[0]);
+        ai0 += 1e-6;
+    }
+    state.SetItemsProcessed(state.iterations()*data.size());
+}
+BENCHMARK(BM_AmplitudeLaw)->Arg(512)->Arg(4096);
+
+// AI scan into the a0..a15 fields
+static void BM_PackScan(benchmark::State& state)
+{
+    double scan[16];
+    nidaq::analogInput msg;
+    for(int i = 0; i < 16; i++)
+        scan[i] = i*0.1;
+    for(auto _ : state){
+        nidaq::packScan(scan, &msg);
+        benchmark::DoNotOptimize(&msg);
+    }
+    state.SetItemsProcessed(state.iterations()*16);
+}
+BENCHMARK(BM_PackScan);
+
+// float64 -> float32 for analogInputBlock, 16 channels x scans
+static void BM_Narrow(benchmark::State& state)
+{
+    std::vector<double> in(16*state.range(0), 0.5);
+    std::vector<float> out(in.size());
+    for(auto _ : state){
+        nidaq::narrow(&in[0], &out[0], in.size());
+        benchmark::DoNotOptimize(&out[0]);
+    }
+    state.SetItemsProcessed(state.iterations()*in.size());
+    state.SetBytesProcessed(state.iterations()*in.size()*sizeof(double));
+}
+BENCHMARK(BM_Narrow)->Arg(1)->Arg(64)->Arg(1024)->Arg(4096);
+
+// same, through the dispatched SIMD kernel
+static void BM_NarrowSimd(benchmark::State& state)
+{
+    std::vector<double> in(16*state.range(0), 0.5);
+    std::vector<float> out(in.size());
+    for(auto _ : state){
+        nidaq::narrowF64(&in[0], &out[0], in.size());
+        benchmark::DoNotOptimize(&out[0]);
+    }
+    state.SetLabel(nidaq::simdLevel());
+    state.SetItemsProcessed(state.iterations()*in.size());
+    state.SetBytesProcessed(state.iterations()*in.size()*sizeof(double));
+}
+BENCHMARK(BM_NarrowSimd)->Arg(1)->Arg(64)->Arg(1024)->Arg(4096);
+
+// scan-major float64 -> channel-major float32, 16 channels x scans
+static void BM_Deinterleave(benchmark::State& state)
+{
+    uint32_t scans = state.range(0);
+    std::vector<double> in(16*scans, 0.5);
+    std::vector<float> out(in.size());
+    for(auto _ : state){
+        nidaq::deinterleave(&in[0], scans, 16, &out[0]);
+        benchmark::DoNotOptimize(&out[0]);
+    }
+    state.SetLabel(nidaq::simdLevel());
+    state.SetItemsProcessed(state.iterations()*in.size());
+}
+BENCHMARK(BM_Deinterleave)->Arg(1)->Arg(4)->Arg(64)->Arg(1024)->Arg(4096);
+
+// same shapes through the compile-time specialized kernels
+static void BM_DeinterleaveShape(benchmark::State& state)
+{
+    uint32_t scans = state.range(0);
+    std::vector<double> in(16*scans, 0.5);
+    std::vector<float> out(in.size());
+    nidaq::BlockKernelFn kernel = nidaq::deinterleaveFor(16, scans);
+    for(auto _ : state){
+        kernel(&in[0], &out[0]);
+        benchmark::DoNotOptimize(&out[0]);
+    }
+    state.SetItemsProcessed(state.iterations()*in.size());
+}
+BENCHMARK(BM_DeinterleaveShape)->Arg(1)->Arg(4)->Arg(64)->Arg(1024)->Arg(4096);
+
+// channel-major -> scan-major for a multi-channel AO write, 2 channels x scans
+static void BM_Interleave(benchmark::State& state)
+{
+    uint32_t scans = state.range(0);
+    std::vector<double> in(2*scans, 0.5);
+    std::vector<double> out(in.size());
+    for(auto _ : state){
+        nidaq::interleave(&in[0], scans, 2, &out[0]);
+        benchmark::DoNotOptimize(&out[0]);
+    }
+    state.SetLabel(nidaq::simdLevel());
+    state.SetItemsProcessed(state.iterations()*in.size());
+}
+BENCHMARK(BM_Interleave)->Arg(512)->Arg(4096);
+
+// raw int16 codes -> volts
+static void BM_ScaleI16(benchmark::State& state)
+{
+    std::vector<int16_t> in(16*state.range(0), 1234);
+    std::vector<float> out(in.size());
+    for(auto _ : state){
+        nidaq::scaleI16(&in[0], &out[0], in.size(), 10.0f/32768, 0.0f);
+        benchmark::DoNotOptimize(&out[0]);
+    }
+    state.SetLabel(nidaq::simdLevel());
+    state.SetItemsProcessed(state.iterations()*in.size());
+}
+BENCHMARK(BM_ScaleI16)->Arg(64)->Arg(4096);
+
+// push/pop through the SPSC ring on one thread (no contention)
+static void BM_RingPushPop(benchmark::State& state)
+{
+    nidaq::RingBuffer<double> ring(1024);
+    double value = 0;
+    for(auto _ : state){
+        for(int i = 0; i < 64; i++)
+            ring.push(i);
+        for(int i = 0; i < 64; i++)
+            ring.pop(&value);
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations()*64);
+}
+BENCHMARK(BM_RingPushPop);
+
+// 4-section lowpass on 16 channels x 4096 scans, over 1..16 pool threads
+static void BM_ChannelFilter(benchmark::State& state)
+{
+    nidaq::FilterConfig config;
+    config.type = "lowpass";
+    config.cutoff = 1000;
+    config.q = 0.7071;
+    config.sections = 4;
+    config.threads = state.range(0);
+    config.channelsPerTask = 1;
+    nidaq::ChannelFilter filter;
+    filter.configure(config, 16, 100000);
+    std::vector<double> in(16*4096, 0.25);
+    std::vector<float> out(in.size());
+    for(auto _ : state){
+        filter.process(&in[0], 4096, &out[0]);
+        benchmark::DoNotOptimize(&out[0]);
+    }
+    state.SetLabel(std::to_string(filter.threads()) + " threads");
+    state.SetItemsProcessed(state.iterations()*in.size());
+}
+BENCHMARK(BM_ChannelFilter)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,44 @@
+#!/bin/bash
+# End-to-end throughput/latency sweep of nidaqAnalog6221 against the
+# software DAQ stand-in (nidaqAnalog6221_sim). Needs a running roscore.
+#
+#   run_throughput.sh [output.csv] [seconds per point]
+#
+# One CSV line per (rate, block size): delivered vs expected scans,
+# sequence gaps, scans lost at the source, latency percentiles, and the
+# CPU use of the publisher and the subscriber. SHM=1 moves the blocks
+# through the shared-memory ring instead of TCPROS.
+
+OUT=${1:-throughput.csv}
+DURATION=${2:-10}
+RATES=${RATES:-"1000 5000 10000 50000 100000 250000"}
+BLOCKS=${BLOCKS:-"1 10 100 1000"}
+SHM_ARGS=""
+[ "${SHM:-0}" = "1" ] && SHM_ARGS="_shm_ring:=nidaq_throughput"
+
+HZ=$(getconf CLK_TCK)
+
+cpu_ticks() {
+    awk '{ print $14 + $15 }' /proc/$1/stat
+}
+
+echo "rate,block_size,blocks,scans,expected_scans,seq_gaps,source_gap_scans,lat_p50_ms,lat_p99_ms,lat_max_ms,sub_cpu_pct,pub_cpu_pct" > "$OUT"
+for rate in $RATES; do
+    for block in $BLOCKS; do
+        rosrun nidaq nidaqAnalog6221_sim __name:=nidaqAnalog6221 _rate:=$rate _block_size:=$block $SHM_ARGS > /dev/null 2>&1 &
+        PUB=$!
+        sleep 2
+
+        START=$(cpu_ticks $PUB)
+        T0=$(date +%s.%N)
+        rosrun nidaq nidaq_throughput_sub _rate:=$rate _block_size:=$block _duration:=$DURATION _output:="$OUT.tmp" $SHM_ARGS > /dev/null 2>&1
+        T1=$(date +%s.%N)
+        END=$(cpu_ticks $PUB)
+        kill -INT $PUB; wait $PUB 2> /dev/null
+
+        PUB_CPU=$(echo "100 * ($END - $START) / $HZ / ($T1 - $T0)" | bc -l)
+        printf "%s,%.1f\n" "$(tail -n 1 "$OUT.tmp")" "$PUB_CPU" >> "$OUT"
+        tail -n 1 "$OUT"
+    done
+done
+rm -f "$OUT.tmp"
@@ -0,0 +1,168 @@
+/*********************************************************************
+*
+* nidaq_throughput_sub:
+*    Instrumented subscriber for the end-to-end throughput benchmark.
+*
+*    Listens to an analogInputBlock topic for ~duration seconds and
+*    then appends one CSV line to ~output:
+*        rate,block_size,blocks,scans,expected_scans,seq_gaps,
+*        source_gap_scans,lat_p50_ms,lat_p99_ms,lat_max_ms,sub_cpu_pct
+*    Latency is from the acquisition time of the newest scan in a
+*    block to its arrival here. seq_gaps counts blocks published but
+*    never received, found from sample_index: a block that starts
+*    later than the previous one ended plus its own gap_samples.
+*    rate and block_size are only copied into the line so
+*    run_throughput.sh can plot the curve.
+*
+*    With ~shm_ring set the blocks are mapped from that shared-memory
+*    ring instead (nidaqAnalog6221 started with the same ~shm_ring);
+*    blocks the reader was lapped on count as sequence gaps.
+*
+*********************************************************************/
+
+#include "ros/ros.h"
+#include "ros/console.h"
+#include "nidaq/analogInputBlock.h"
+#include "nidaq/shm_ring.h"
+#include <stdio.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <vector>
+
+using namespace ros;
+
+static uint64_t             blocks = 0;
+static uint64_t             scans = 0;
+static uint64_t             seqGaps = 0;
+static uint64_t             sourceGaps = 0;
+static uint64_t             nextIndex = 0;      // sample_index the next block starts at
+static uint64_t             lastShmSeq = 0;
+static Time                 firstStamp;
+static Time                 lastStamp;
+static std::vector<double>  latencies;
+
+static void countBlock(const Time& stamp, uint64_t lostBlocks, uint32_t blockScans, double samplePeriod, uint32_t gap)
+{
+    Time now = Time::now();
+    Time newest = stamp + Duration(samplePeriod*(blockScans > 0 ? blockScans - 1 : 0));
+
+    if(blocks == 0)
+        firstStamp = stamp;
+    seqGaps += lostBlocks;
+    lastStamp = newest;
+
+    blocks++;
+    scans += blockScans;
+    sourceGaps += gap;
+    latencies.push_back((now - newest).toSec()*1e3);
+}
+
+void blockCallback(const nidaq::analogInputBlock::ConstPtr& msg)
+{
+    // roscpp numbers header.seq itself, so losses are told from the sample index
+    uint64_t lost = 0;
+    if(blocks > 0 && msg->scans > 0 && msg->sample_index > nextIndex + msg->gap_samples)
+        lost = (msg->sample_index - nextIndex - msg->gap_samples)/msg->scans;
+    nextIndex = msg->sample_index + msg->scans;
+    countBlock(msg->header.stamp, lost, msg->scans, msg->sample_period, msg->gap_samples);
+}
+
+static void pollShm(nidaq::ShmRingReader* reader, double timeoutSec)
+{
+    nidaq::ShmBlockView view;
+    uint64_t lost;
+    reader->wait(timeoutSec);
+    for(;;){
+        nidaq::ShmRingReader::Status status = reader->next(&view, &lost);
+        if(status == nidaq::ShmRingReader::EMPTY)
+            return;
+        if(status == nidaq::ShmRingReader::LOST)
+            continue;   // shows up as a sequence gap on the next block
+        Time stamp;
+        stamp.fromNSec(view.stampNs);
+        if(!reader->valid(view))
+            continue;
+        countBlock(stamp, blocks > 0 ? view.blockSeq - lastShmSeq - 1 : 0, view.scans, view.samplePeriod, view.gapSamples);
+        lastShmSeq = view.blockSeq;
+    }
+}
+
+static double percentile(std::vector<double>& v, double p)
+{
+    if(v.empty())
+        return 0;
+    size_t k = (size_t)(p*(v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+static double cpuSeconds()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec*1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec*1e-6;
+}
+
+int main(int argc, char **argv)
+{
+    init(argc, argv, "nidaq_throughput_sub");
+    NodeHandle n;
+    NodeHandle pn("~");
+
+    std::string topic, output, shmName;
+    double duration, rate;
+    int blockSize;
+    pn.param("topic", topic, std::string("nidaqAnalog6221/block"));
+    pn.param("output", output, std::string("throughput.csv"));
+    pn.param("duration", duration, 10.0);
+    pn.param("rate", rate, 0.0);
+    pn.param("block_size", blockSize, 0);
+    pn.param("shm_ring", shmName, std::string(""));
+
+    latencies.reserve(1000000);
+    Subscriber sub;
+    nidaq::ShmRingReader reader;
+    if(shmName.empty())
+        sub = n.subscribe(topic, 1000, blockCallback, TransportHints().tcpNoDelay());
+    else if(!reader.attach(shmName))
+        return 1;
+
+    // wait for the first block, then measure for duration seconds
+    while(ok() && blocks == 0){
+        if(reader.isAttached())
+            pollShm(&reader, 0.1);
+        else
+            spinOnce();
+    }
+    double cpuStart = cpuSeconds();
+    WallTime start = WallTime::now();
+    while(ok() && (WallTime::now() - start).toSec() < duration){
+        if(reader.isAttached()){
+            pollShm(&reader, 0.1);
+            continue;
+        }
+        spinOnce();
+        WallDuration(0.001).sleep();
+    }
+    double wall = (WallTime::now() - start).toSec();
+    double cpu = cpuSeconds() - cpuStart;
+
+    uint64_t expected = rate > 0 ? (uint64_t)((lastStamp - firstStamp).toSec()*rate) + 1 : scans;
+    double p50 = percentile(latencies, 0.50);
+    double p99 = percentile(latencies, 0.99);
+    double pmax = latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end());
+
+    FILE *out = fopen(output.c_str(), "a");
+    if(out == NULL){
+        ROS_ERROR("Cannot open %s", output.c_str());
+        return 1;
+    }
+    fprintf(out, "%.0f,%d,%llu,%llu,%llu,%llu,%llu,%.3f,%.3f,%.3f,%.1f\n", rate, blockSize,
+        (unsigned long long)blocks, (unsigned long long)scans, (unsigned long long)expected,
+        (unsigned long long)seqGaps, (unsigned long long)sourceGaps, p50, p99, pmax, 100.0*cpu/wall);
+    fclose(out);
+
+    ROS_INFO("%llu scans in %llu blocks, %llu sequence gaps, %llu scans lost at the source, latency p50 %.3f ms p99 %.3f ms",
+        (unsigned long long)scans, (unsigned long long)blocks, (unsigned long long)seqGaps, (unsigned long long)sourceGaps, p50, p99);
+    return 0;
+}
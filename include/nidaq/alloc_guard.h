@@ -0,0 +1,64 @@
+#ifndef NIDAQ_ALLOC_GUARD_H
+#define NIDAQ_ALLOC_GUARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*********************************************************************
+*    Allocation guard for the steady-state loops (debug only).
+*
+*    libnidaq_alloc_guard.so replaces malloc and friends and counts
+*    every heap allocation a thread makes while it is armed. Nothing is
+*    linked against it; it is preloaded when wanted:
+*
+*        NIDAQ_ALLOC_GUARD=report LD_PRELOAD=libnidaq_alloc_guard.so rosrun nidaq nidaqAnalog6221
+*
+*    report counts and logs them, abort prints the allocation with a
+*    backtrace and aborts on the first one. Without the preload (or
+*    with NIDAQ_ALLOC_GUARD unset) the functions below do nothing.
+*    They find the preloaded hooks with dlsym() rather than through
+*    weak symbols, which a non-PIE executable resolves to 0 at link
+*    time whatever is preloaded later.
+*    Calls into roscpp, which allocates by design (publish, spinOnce),
+*    run under an AllocGuardExternal: what they allocate is counted
+*    apart and never aborts, so it neither hides nor trips over an
+*    allocation in our own code. Logging and error recovery, which are
+*    not the steady state, run under an AllocGuardPause.
+*********************************************************************/
+
+namespace nidaq {
+
+// the hooks are looked up in the preloaded library on first use
+bool allocGuardActive();
+void allocGuardArm();
+void allocGuardDisarm();
+
+// allocations seen in armed sections so far, all threads
+uint64_t allocGuardCount();
+
+// allocations seen in external sections of armed threads, all threads
+uint64_t allocGuardExternalCount();
+
+/*********************************************************************
+*    Marks a call into code we do not own (roscpp): while armed, its
+*    allocations go to allocGuardExternalCount() instead. Nests.
+*********************************************************************/
+class AllocGuardExternal {
+public:
+    AllocGuardExternal();
+    ~AllocGuardExternal();
+};
+
+/*********************************************************************
+*    Disarms for the scope of a call that is allowed to allocate and
+*    rearms afterwards if the guard was armed before. Nests.
+*********************************************************************/
+class AllocGuardPause {
+public:
+    AllocGuardPause() { allocGuardDisarm(); }
+    ~AllocGuardPause() { allocGuardArm(); }
+};
+
+}
+
+#endif
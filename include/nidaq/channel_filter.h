@@ -0,0 +1,79 @@
+#ifndef NIDAQ_CHANNEL_FILTER_H
+#define NIDAQ_CHANNEL_FILTER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "ros/ros.h"
+#include "nidaq/thread_pool.h"
+
+namespace nidaq {
+
+// b0 + b1 z^-1 + b2 z^-2 over 1 + a1 z^-1 + a2 z^-2
+struct Biquad {
+    double  b0, b1, b2;
+    double  a1, a2;
+};
+
+// RBJ cookbook lowpass, highpass or bandpass; false for an unknown type or cutoff >= rate/2
+bool designBiquad(const std::string& type, double cutoff, double q, double rate, Biquad* out);
+
+/*********************************************************************
+*    Per-channel processing stage of the AI nodes, read from
+*    ~process/...; filter "none" (the default) disables it.
+*********************************************************************/
+struct FilterConfig {
+    std::string type;           // none, lowpass, highpass, bandpass
+    double      cutoff;         // Hz, the centre for bandpass
+    double      q;
+    int         sections;       // identical biquads in cascade, up to 8
+    int         threads;        // pool size, 0: one per CPU
+    int         channelsPerTask;
+};
+
+void loadFilterConfig(const ros::NodeHandle& nh, FilterConfig* config);
+
+/*********************************************************************
+*    Runs a biquad cascade over every channel of an acquired block.
+*    The channels are split into tasks of channelsPerTask on a
+*    ThreadPool; each task reads its channels straight out of the
+*    scan-major block and writes them channel-major, so the output is
+*    in channel order whatever thread ran which task. Filter state
+*    carries over from block to block; reset() clears it, e.g. after
+*    a gap.
+*********************************************************************/
+class ChannelFilter {
+public:
+    ChannelFilter();
+    ~ChannelFilter();
+
+    bool configure(const FilterConfig& config, uint32_t channels, double rate);
+    bool enabled() const { return pool_ != NULL; }
+    int threads() const { return pool_ != NULL ? pool_->threads() : 0; }
+
+    void process(const double* scanMajor, uint32_t scans, float* channelMajor);
+    void reset();
+
+private:
+    ChannelFilter(const ChannelFilter&);
+    ChannelFilter& operator=(const ChannelFilter&);
+
+    static void task(void* ctx, size_t index);
+    void filterChannel(uint32_t channel);
+
+    ThreadPool*         pool_;
+    Biquad              coeffs_;
+    int                 sections_;
+    uint32_t            channels_;
+    uint32_t            perTask_;
+    std::vector<double> state_;         // [channel][section][2]
+
+    // the block being processed
+    const double*       in_;
+    uint32_t            scans_;
+    float*              out_;
+};
+
+}
+
+#endif
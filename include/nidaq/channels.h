@@ -0,0 +1,32 @@
+#ifndef NIDAQ_CHANNELS_H
+#define NIDAQ_CHANNELS_H
+
+#include <string>
+#include <vector>
+
+namespace nidaq {
+
+/*********************************************************************
+*    Counts the physical channels in a DAQmx channel list such as
+*    "Dev1/ai0:15" or "Dev2/ai0,Dev2/ai3,Dev2/ai5:7".
+*    Returns 0 for an empty or malformed list.
+*********************************************************************/
+int countChannels(const std::string& list);
+
+/*********************************************************************
+*    The physical channels of such a list one by one, in task order:
+*    "Dev1/ao0:1" gives "Dev1/ao0", "Dev1/ao1". False (and names
+*    cleared) for an empty or malformed list.
+*********************************************************************/
+bool expandChannels(const std::string& list, std::vector<std::string>* names);
+
+/*********************************************************************
+*    Channel indices of a task from a list such as "0:3,7,12:15" (an
+*    "ai" prefix is allowed), all below channels. False for an empty,
+*    malformed or out-of-range list.
+*********************************************************************/
+bool parseChannelIndices(const std::string& list, int channels, std::vector<int>* indices);
+
+}
+
+#endif
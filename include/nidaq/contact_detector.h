@@ -0,0 +1,59 @@
+#ifndef NIDAQ_CONTACT_DETECTOR_H
+#define NIDAQ_CONTACT_DETECTOR_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace nidaq {
+
+struct ContactChange {
+    uint32_t    channel;
+    bool        contact;        // true: touched, false: released
+    uint64_t    sample;         // first sample of the run that made the change
+    float       force;          // that sample's value
+};
+
+/*********************************************************************
+*    Per-sample contact detection on a force channel array.
+*
+*    A channel goes into contact once its force has been at or above
+*    on for debounce consecutive samples, and out of it once it has
+*    been at or below off (< on, the hysteresis) as long. Each change
+*    is reported with the first sample of the run that caused it, so
+*    its time is the sample clock time of the edge itself while the
+*    decision is made debounce - 1 samples later. The state carries
+*    over from block to block; reset() starts every channel released.
+*    After a gap in the samples restartRuns() drops the runs in
+*    progress, so no run spans the gap, and keeps the contact state.
+*********************************************************************/
+class ContactDetector {
+public:
+    ContactDetector();
+
+    bool configure(uint32_t channels, double on, double off, uint32_t debounce);
+    void reset();
+    void restartRuns();
+
+    // scan-major block whose first scan has index first; changes are appended
+    void process(const double* block, uint32_t scans, uint64_t first, std::vector<ContactChange>* changes);
+
+    bool contact(uint32_t channel) const { return channels_[channel].contact; }
+    uint32_t channels() const { return (uint32_t)channels_.size(); }
+
+private:
+    struct Channel {
+        bool        contact;
+        uint32_t    run;            // consecutive samples arguing for the other state
+        uint64_t    runStart;
+        float       runForce;
+    };
+
+    std::vector<Channel>    channels_;
+    double                  on_;
+    double                  off_;
+    uint32_t                debounce_;
+};
+
+}
+
+#endif
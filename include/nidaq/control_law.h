@@ -0,0 +1,97 @@
+#ifndef NIDAQ_CONTROL_LAW_H
+#define NIDAQ_CONTROL_LAW_H
+
+#include <stdint.h>
+#include <string>
+#include "ros/ros.h"
+#include "nidaq/rt_profile.h"
+
+namespace nidaq {
+
+/*********************************************************************
+*    What a control law sees on every step: the AI block just read
+*    (scan-major, as DAQmx_Val_GroupByScanNumber returns it), its
+*    newest scan, the time of that scan and the time since the last
+*    step.
+*********************************************************************/
+struct ControlInput {
+    const double*   block;
+    uint32_t        scans;
+    uint32_t        channels;
+    const double*   scan;       // newest scan, block + (scans-1)*channels
+    double          time;       // seconds, stamp of the newest scan
+    double          dt;         // seconds since the previous step, 0 on the first
+};
+
+/*********************************************************************
+*    A control law turns AI blocks into the AO buffer. configure() is
+*    called once before the loop with the AO buffer length and the
+*    number of AI channels every ControlInput will carry; it is the only
+*    place that may allocate, read parameters (under ~law/) or reject
+*    them, e.g. a ~law/channel the task does not have. update() runs in the
+*    acquisition thread on every block and must not allocate, block or
+*    log.
+*
+*    Laws are picked by name with ~control_law. Built in are
+*    "amplitude" (the amplitude law of Modified6221), "gain", "pid",
+*    "lut" and "frequency". Any other name of the form
+*    "/path/libmylaw.so" is loaded with dlopen(); the library exports
+*    its law with NIDAQ_EXPORT_CONTROL_LAW(MyLaw).
+*********************************************************************/
+class ControlLaw {
+public:
+    virtual ~ControlLaw() {}
+
+    virtual bool configure(const ros::NodeHandle& nh, uint32_t aoSamples, uint32_t aiChannels) = 0;
+    virtual void reset() {}
+    virtual void update(const ControlInput& in, double* ao, uint32_t aoSamples) = 0;
+};
+
+typedef ControlLaw* (*ControlLawFactory)();
+
+void registerControlLaw(const std::string& name, ControlLawFactory factory);
+// NULL (and logged) if the name is unknown or the plug-in cannot be loaded
+ControlLaw* createControlLaw(const std::string& name);
+
+#define NIDAQ_EXPORT_CONTROL_LAW(LawClass) \
+    extern "C" nidaq::ControlLaw* nidaq_create_control_law() { return new LawClass(); }
+
+/*********************************************************************
+*    Runs the configured law once per AI block, clamps its output to
+*    [~control_min, ~control_max] and checks it against the latency
+*    budget, ~control_budget_us per AI scan in the block (0 = none).
+*    A step over budget still has its output used; it is counted and
+*    reported by printStats(), never logged from the loop.
+*********************************************************************/
+class ControlLoop {
+public:
+    struct Stats {
+        uint64_t    steps;
+        uint64_t    overBudget;
+        JitterStats latency;    // microseconds per step
+    };
+
+    ControlLoop();
+    ~ControlLoop();
+
+    bool configure(const ros::NodeHandle& nh, uint32_t aoSamples, uint32_t aiChannels);
+    bool step(const ControlInput& in, double* ao);
+
+    const std::string& lawName() const { return name_; }
+    const Stats& stats() const { return stats_; }
+    void resetStats();
+    void printStats(const char* label) const;
+
+private:
+    ControlLaw*     law_;
+    std::string     name_;
+    uint32_t        aoSamples_;
+    double          budgetUs_;
+    double          min_;
+    double          max_;
+    Stats           stats_;
+};
+
+}
+
+#endif
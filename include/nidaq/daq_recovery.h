@@ -0,0 +1,53 @@
+#ifndef NIDAQ_DAQ_RECOVERY_H
+#define NIDAQ_DAQ_RECOVERY_H
+
+#include <NIDAQmxBase.h>
+#include <stdint.h>
+#include "nidaq/daqDiagnostics.h"
+
+namespace nidaq {
+
+/*********************************************************************
+*    Error classes: buffer overruns (AI) and underruns (AO) are
+*    recovered by restarting only the affected task; timeouts are
+*    counted and the loop carries on; everything else is fatal and
+*    still goes to the node's Error: label.
+*********************************************************************/
+enum DaqErrorClass { DAQ_OK, DAQ_OVERRUN, DAQ_UNDERRUN, DAQ_TIMEOUT, DAQ_FATAL };
+
+struct RecoveryStats {
+    uint64_t    overruns;
+    uint64_t    underruns;
+    uint64_t    timeouts;
+    uint64_t    restarts;
+    uint64_t    gapSamples;     // samples lost across all restarts
+    double      lastRecoverMs;
+    double      maxRecoverMs;
+};
+
+DaqErrorClass classifyDaqError(int32 error);
+const char* daqErrorClassName(DaqErrorClass cls);
+
+void resetRecoveryStats(RecoveryStats* stats);
+
+/*********************************************************************
+*    Handles a failed DAQmx call on task: returns false for a fatal
+*    error, otherwise counts it, restarts the task when needed and
+*    returns true. Only this task is stopped, others keep running.
+*********************************************************************/
+bool recoverTask(TaskHandle task, int32 error, RecoveryStats* stats);
+
+void fillDiagnostics(const RecoveryStats& stats, daqDiagnostics* msg);
+
+/*********************************************************************
+*    Streamed AO (new data on every write) must underrun when the
+*    writer falls behind, not replay what is left in the buffer.
+*    Turns regeneration off on task; false (and logged) if it fails or
+*    this NI-DAQmx Base has no DAQmx_Write_RegenMode, and the caller
+*    must not stream then.
+*********************************************************************/
+bool disableRegeneration(TaskHandle task);
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef NIDAQ_KERNELS_H
+#define NIDAQ_KERNELS_H
+
+#include <math.h>
+#include <stdint.h>
+#include "nidaq/analogInput.h"
+
+namespace nidaq {
+
+#define NIDAQ_PI	3.1415926535
+
+/*********************************************************************
+*    One period of a sine over n samples, as written to the AO buffers.
+*********************************************************************/
+inline void fillSine(double* buffer, uint32_t n, double amplitude)
+{
+    for(uint32_t i = 0; i < n; i++)
+        buffer[i] = amplitude*sin((double)i*2.0*NIDAQ_PI/(double)n);
+}
+
+/*********************************************************************
+*    Amplitude law of Modified6221: the unit sine scaled by where ai0
+*    sits between the smallest and largest value seen so far.
+*    Outputs 0 until the range is known (minV >= maxV).
+*********************************************************************/
+inline void amplitudeLaw(const double* unitSine, uint32_t n, double ai0, double minV, double maxV, double amplitude, double* out)
+{
+    if(minV >= maxV){
+        for(uint32_t i = 0; i < n; i++)
+            out[i] = 0;	//bug fix from min being too big and max too small
+        return;
+    }
+    double gain = amplitude*((ai0 - minV)/(maxV - minV));
+    for(uint32_t i = 0; i < n; i++)
+        out[i] = gain*unitSine[i];
+}
+
+inline void narrow(const double* in, float* out, uint32_t n)
+{
+    for(uint32_t i = 0; i < n; i++)
+        out[i] = (float)in[i];
+}
+
+/*********************************************************************
+*    Picks count channels out of a scan-major block of channels per
+*    scan, into a scan-major block of count channels.
+*********************************************************************/
+inline void gatherChannels(const double* in, uint32_t scans, int channels, const int* picks, int count, float* out)
+{
+    for(uint32_t s = 0; s < scans; s++, in += channels)
+        for(int k = 0; k < count; k++)
+            *out++ = (float)in[picks[k]];
+}
+
+/*********************************************************************
+*    Copies one 16-channel scan into the named fields of analogInput.
+*********************************************************************/
+inline void packScan(const double* scan, analogInput* msg)
+{
+    msg->a0 = scan[0];
+    msg->a1 = scan[1];
+    msg->a2 = scan[2];
+    msg->a3 = scan[3];
+    msg->a4 = scan[4];
+    msg->a5 = scan[5];
+    msg->a6 = scan[6];
+    msg->a7 = scan[7];
+    msg->a8 = scan[8];
+    msg->a9 = scan[9];
+    msg->a10 = scan[10];
+    msg->a11 = scan[11];
+    msg->a12 = scan[12];
+    msg->a13 = scan[13];
+    msg->a14 = scan[14];
+    msg->a15 = scan[15];
+}
+
+}
+
+#endif
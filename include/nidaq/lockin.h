@@ -0,0 +1,62 @@
+#ifndef NIDAQ_LOCKIN_H
+#define NIDAQ_LOCKIN_H
+
+#include <stdint.h>
+#include <vector>
+#include "nidaq/waveform.h"
+
+namespace nidaq {
+
+/*********************************************************************
+*    Digital lock-in over every channel of a scan-major AI block.
+*
+*    The reference is one period of the AO buffer: for the excitation
+*    spec the in-phase table holds sin(theta[k]) and the quadrature
+*    table cos(theta[k]), theta[k] being the phase the AO sample k was
+*    generated with. With the AO task clocked by the AI sample clock,
+*    scan n meets AO sample n mod length, so process() only needs the
+*    position of the first scan in the AO buffer and the reference is
+*    coherent with what the board actually put out.
+*
+*    Each channel is multiplied by both tables and run through order
+*    cascaded first-order low-pass stages with time constant tau. The
+*    channels of a scan sit side by side in the block, so the mixing
+*    and every stage run on all channels at once in SIMD lanes (AVX2
+*    or SSE2, picked at run time as in simd_kernels.h). A response
+*    a*sin(theta + phi) reads back as x = a*cos(phi), y = a*sin(phi).
+*********************************************************************/
+class LockIn {
+public:
+    LockIn();
+
+    // false for a DC spec, an empty buffer or a bad tau/order
+    bool configure(const WaveformSpec& excitation, uint32_t length, uint32_t channels,
+                   double rate, double tau, int order);
+
+    // position: index of the block's first scan in the AO buffer, any size
+    void process(const double* scanMajor, uint32_t scans, uint64_t position);
+    void reset();
+
+    uint32_t channels() const { return channels_; }
+    double frequency() const { return frequency_; }
+    double settleTime() const;      // to within about 1e-3 of a step
+
+    // V peak and radians relative to the excitation
+    void result(uint32_t channel, double* x, double* y) const;
+    void polar(uint32_t channel, double* amplitude, double* phase) const;
+
+private:
+    uint32_t            channels_;
+    uint32_t            length_;
+    int                 order_;
+    double              alpha_;         // 1 - exp(-1/(rate*tau))
+    double              tau_;
+    double              frequency_;
+    std::vector<double> inPhase_;       // [length]
+    std::vector<double> quadrature_;
+    std::vector<double> state_;         // [stage][x, y][channel]
+};
+
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef NIDAQ_LOOP_SCHEDULER_H
+#define NIDAQ_LOOP_SCHEDULER_H
+
+#include <stdint.h>
+#include <string>
+#include "nidaq/rt_profile.h"
+
+namespace nidaq {
+
+/*********************************************************************
+*    Loop pacing on absolute deadlines (CLOCK_MONOTONIC), replacing
+*    ros::Rate which sleeps relative to the previous call and drifts
+*    whenever an iteration overruns.
+*
+*    CATCH_UP keeps every deadline: after an overrun the loop runs
+*    back to back until it is on schedule again.
+*    SKIP drops the slots that already passed and waits for the next
+*    one in the future, so the phase is kept but iterations are lost.
+*
+*    When the loop is paced by a blocking hardware-timed read, use
+*    hardwareTick() instead of wait(): nothing sleeps and the backlog
+*    left in the DAQ buffer is what counts as lateness.
+*********************************************************************/
+class LoopScheduler {
+public:
+    enum Policy { CATCH_UP, SKIP };
+
+    struct Stats {
+        uint64_t    loops;
+        uint64_t    missed;     // deadlines already passed when the loop finished
+        uint64_t    skipped;    // slots dropped by the SKIP policy
+        JitterStats lateness;   // microseconds past the deadline, at wakeup
+    };
+
+    LoopScheduler(double rateHz, Policy policy);
+
+    void start();
+    void wait();
+    void hardwareTick(uint64_t backlogSamples, double sampleRate, uint64_t samplesPerLoop);
+
+    const Stats& stats() const { return stats_; }
+    void resetStats();
+    void printStats(const char* label) const;
+
+    static Policy parsePolicy(const std::string& name);
+
+private:
+    int64_t     period_;        // ns
+    int64_t     deadline_;      // ns, CLOCK_MONOTONIC
+    Policy      policy_;
+    Stats       stats_;
+};
+
+int64_t monotonicNs();
+
+}
+
+#endif
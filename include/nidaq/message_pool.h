@@ -0,0 +1,68 @@
+#ifndef NIDAQ_MESSAGE_POOL_H
+#define NIDAQ_MESSAGE_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace nidaq {
+
+/*********************************************************************
+*    Preallocated messages for publishing by shared pointer.
+*
+*    roscpp keeps a published shared_ptr for as long as it still has
+*    to serialize it or hand it to same-process subscribers, so a
+*    message can only be reused once the pool holds the only
+*    reference. acquire() returns the next such message, with all its
+*    vectors still sized from last time (resize() within the reserved
+*    capacity does not allocate). The pool grows only when every
+*    message is still in flight; grown() counts those allocations.
+*********************************************************************/
+template <typename M>
+class MessagePool {
+public:
+    explicit MessagePool(size_t size)
+        : next_(0), grown_(0)
+    {
+        pool_.reserve(size > 0 ? size : 1);
+        for(size_t i = 0; i < pool_.capacity(); i++)
+            pool_.push_back(boost::make_shared<M>());
+    }
+
+    // M::data vectors reserved to n elements up front
+    template <typename T>
+    void reserve(std::vector<T> M::*field, size_t n)
+    {
+        for(size_t i = 0; i < pool_.size(); i++)
+            ((*pool_[i]).*field).reserve(n);
+    }
+
+    boost::shared_ptr<M> acquire()
+    {
+        for(size_t k = 0; k < pool_.size(); k++){
+            size_t i = (next_ + k) % pool_.size();
+            if(pool_[i].unique()){
+                next_ = i + 1;
+                return pool_[i];
+            }
+        }
+        grown_++;
+        pool_.push_back(boost::make_shared<M>(*pool_[0]));     // a copy comes with its vectors sized
+        next_ = 0;
+        return pool_.back();
+    }
+
+    size_t size() const { return pool_.size(); }
+    uint64_t grown() const { return grown_; }
+
+private:
+    std::vector<boost::shared_ptr<M> >  pool_;
+    size_t                              next_;
+    uint64_t                            grown_;
+};
+
+}
+
+#endif
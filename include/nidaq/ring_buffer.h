@@ -0,0 +1,61 @@
+#ifndef NIDAQ_RING_BUFFER_H
+#define NIDAQ_RING_BUFFER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+namespace nidaq {
+
+/*********************************************************************
+*    Lock-free single-producer single-consumer ring of T, for handing
+*    samples or blocks from one thread to another. Capacity is rounded
+*    up to a power of two; push() fails when full, pop() when empty.
+*********************************************************************/
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t capacity)
+        : head_(0), tail_(0)
+    {
+        size_t size = 1;
+        while(size < capacity)
+            size <<= 1;
+        buffer_.resize(size);
+        mask_ = size - 1;
+    }
+
+    bool push(const T& item)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if(head - tail_.load(std::memory_order_acquire) > mask_)
+            return false;
+        buffer_[head & mask_] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T* item)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if(tail == head_.load(std::memory_order_acquire))
+            return false;
+        *item = buffer_[tail & mask_];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    std::vector<T>      buffer_;
+    size_t              mask_;
+    // producer and consumer indices on separate cache lines
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+};
+
+}
+
+#endif
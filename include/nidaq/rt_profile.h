@@ -0,0 +1,63 @@
+#ifndef NIDAQ_RT_PROFILE_H
+#define NIDAQ_RT_PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ros/ros.h"
+
+namespace nidaq {
+
+/*********************************************************************
+*    Opt-in real-time execution profile for acquisition and control
+*    threads. Everything is read from the private namespace (~rt/...)
+*    and is left untouched unless ~rt/enabled is true.
+*********************************************************************/
+struct RtProfile {
+    bool    enabled;
+    int     priority;       // SCHED_FIFO priority, 1..99
+    int     cpu;            // CPU to pin the thread to, -1 leaves affinity alone
+    bool    lockMemory;     // mlockall(MCL_CURRENT | MCL_FUTURE)
+    size_t  prefaultStack;  // bytes of stack touched up front
+    bool    hugepages;      // back sample buffers with MAP_HUGETLB when possible
+    int     jitterLoops;    // iterations of the jitter probe, 0 disables it
+};
+
+struct JitterStats {
+    uint64_t    count;
+    double      min;        // wakeup lateness, microseconds
+    double      max;
+    double      sum;
+    double      sumSq;
+};
+
+void loadRtProfile(const ros::NodeHandle& nh, RtProfile* profile);
+
+/*********************************************************************
+*    Applies the profile to the calling thread (scheduler, affinity,
+*    stack) and to the process (memory locking). Failures are logged
+*    and the remaining steps still run; returns 0 if all succeeded.
+*********************************************************************/
+int applyRtProfile(const RtProfile& profile);
+
+/*********************************************************************
+*    Sample buffers: hugepage-backed when requested and available,
+*    prefaulted and locked so the loop never takes a page fault on them.
+*    The mapped length is returned through mapped and goes to rtFree.
+*********************************************************************/
+void* rtAlloc(size_t bytes, const RtProfile& profile, size_t* mapped);
+void rtFree(void* buffer, size_t mapped);
+
+void jitterReset(JitterStats* stats);
+void jitterAdd(JitterStats* stats, double latenessUs);
+double jitterStdDev(const JitterStats& stats);
+void jitterPrint(const char* label, const JitterStats& stats);
+
+/*********************************************************************
+*    Sleeps to absolute deadlines at rateHz for the given number of
+*    loops and records how late each wakeup was.
+*********************************************************************/
+JitterStats measureJitter(double rateHz, int loops);
+
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef NIDAQ_SAMPLE_CLOCK_H
+#define NIDAQ_SAMPLE_CLOCK_H
+
+#include <stdint.h>
+#include <vector>
+#include "ros/ros.h"
+
+namespace nidaq {
+
+/*********************************************************************
+*    Maps sample indices of a hardware-timed task to host time.
+*
+*    Every read gives one observation: the number of samples the board
+*    had acquired when the read returned, and the host time it returned.
+*    The host time is late by a non-negative, noisy latency, so the
+*    sample period is a least-squares fit over a sliding window, and
+*    the offset is taken from the lower envelope (the observation with
+*    the least latency). stamp(n) = offset + n*period then gives every
+*    sample a timestamp with the read latency and scheduling noise
+*    removed. skewPpm() is how far the board clock runs from nominal.
+*
+*    After a task restart the board counter starts over; reset() drops
+*    the window and re-anchors sample firstSample at firstSampleTime
+*    while keeping the fitted period.
+*
+*    sampleRate must be the rate the board really runs at (see
+*    boardSampleRate()): fits further than 1000 ppm from it are taken
+*    for stalls and thrown away. The period is refitted on every update
+*    while the window fills, then every REFIT_EVERY updates; in between
+*    only the newest observation can lower the offset.
+*********************************************************************/
+class SampleClock {
+public:
+    enum { REFIT_EVERY = 32 };
+
+    SampleClock(double sampleRate, size_t window = 1024);
+
+    void update(uint64_t samplesAcquired, const ros::Time& readDone);
+    void reset(uint64_t firstSample, const ros::Time& firstSampleTime);
+    ros::Time stamp(uint64_t sampleIndex) const;
+
+    double period() const { return period_; }
+    double skewPpm() const { return (period_*nominalRate_ - 1.0)*1e6; }
+    bool valid() const { return count_ > 0; }
+
+private:
+    double fit(double period, bool lowerOnly) const;
+
+    double              nominalRate_;
+    double              period_;        // fitted seconds per sample
+    double              offset_;        // seconds since anchor of sample 0
+    ros::Time           anchor_;        // host time of the first observation
+    std::vector<double> samples_;       // window of (samples, seconds since anchor)
+    std::vector<double> times_;
+    size_t              count_;
+    size_t              next_;
+    size_t              sinceFit_;      // updates since the last refit
+};
+
+// The rate a board clock actually runs at for a requested rate: DAQmx
+// divides the timebase (20 MHz on the M series) by the nearest whole
+// number, so 240 kS/s comes out as 20 MHz/83 = 240963.9 S/s.
+double boardSampleRate(double requested, double timebase = 20e6);
+
+}
+
+#endif
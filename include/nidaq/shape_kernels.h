@@ -0,0 +1,68 @@
+#ifndef NIDAQ_SHAPE_KERNELS_H
+#define NIDAQ_SHAPE_KERNELS_H
+
+#include <stdint.h>
+#include <string.h>
+#include "nidaq/simd_kernels.h"
+
+namespace nidaq {
+
+/*********************************************************************
+*    Block kernels specialized at compile time on the block shape
+*    (Channels x Scans). With the shape known, each one picks its
+*    best strategy up front instead of testing sizes on every call:
+*
+*    - one channel, or one scan, is a plain narrow (no transpose);
+*    - blocks under 8 samples are converted inline, unrolled;
+*    - long blocks of many channels are transposed in 64-scan chunks
+*      through a stack buffer. Channel rows of >= 1024 floats are a
+*      multiple of 4 KiB apart, and storing straight into them makes
+*      every store alias the others in the store buffer;
+*    - everything else uses the runtime SIMD kernels.
+*
+*    The common shapes (1, 8, 16, 32 channels x 1..4096 scans, powers
+*    of two) are instantiated in shape_kernels.cpp and looked up with
+*    deinterleaveFor(); other shapes get NULL and callers fall back to
+*    the runtime kernels. A scan-major narrow has nothing to specialize
+*    beyond its length, so it always goes through narrowF64().
+*********************************************************************/
+template <uint32_t Channels, uint32_t Scans>
+struct ScanKernels {
+    enum { Samples = Channels*Scans, Chunk = 64 };
+
+    static void narrow(const double* in, float* out)
+    {
+        if(Samples < 8){
+            for(uint32_t i = 0; i < Samples; i++)
+                out[i] = (float)in[i];
+        }else{
+            narrowF64(in, out, Samples);
+        }
+    }
+
+    // in[s*Channels + c] -> out[c*Scans + s]
+    static void deinterleave(const double* in, float* out)
+    {
+        if(Channels == 1 || Scans == 1){
+            narrow(in, out);
+        }else if(Scans >= 1024 && Channels >= 16 && Scans % Chunk == 0){
+            float tmp[Channels*Chunk];
+            for(uint32_t s0 = 0; s0 < Scans; s0 += Chunk){
+                nidaq::deinterleave(in + (size_t)s0*Channels, Chunk, Channels, tmp);
+                for(uint32_t c = 0; c < Channels; c++)
+                    memcpy(out + (size_t)c*Scans + s0, tmp + c*Chunk, Chunk*sizeof(float));
+            }
+        }else{
+            nidaq::deinterleave(in, Scans, Channels, out);
+        }
+    }
+};
+
+typedef void (*BlockKernelFn)(const double* in, float* out);
+
+// specialized kernel for a common shape, NULL otherwise
+BlockKernelFn deinterleaveFor(uint32_t channels, uint32_t scans);
+
+}
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef NIDAQ_SHM_RING_H
+#define NIDAQ_SHM_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace nidaq {
+
+/*********************************************************************
+*    Shared-memory ring of sample blocks for consumers on the same
+*    host (POSIX shm, /dev/shm/<name>).
+*
+*    One writer, any number of readers, nobody blocks the writer: the
+*    ring has slotCount slots of up to maxScans x channels float32,
+*    block n goes to slot n % slotCount and a slow reader simply loses
+*    the blocks that were overwritten (next() tells it how many).
+*
+*    Each slot carries a sequence word used as a seqlock: 2n+1 while
+*    block n is being written, 2n+2 once it is complete. A reader maps
+*    the slot in place (no copy), and after it is done with the data
+*    checks valid() to make sure the writer did not lap it meanwhile.
+*
+*    Readers claim one of the cursor slots in the header on attach, so
+*    the writer side can see how far behind each of them is. Readers
+*    that want to sleep until the next block use wait(), a futex on the
+*    shared mapping; the writer only makes the wake syscall when
+*    somebody is actually waiting.
+*********************************************************************/
+
+#define NIDAQ_SHM_MAGIC         0x4e494451u     // "NIDQ"
+#define NIDAQ_SHM_VERSION       1
+#define NIDAQ_SHM_MAX_READERS   16
+
+struct ShmSlot {
+    std::atomic<uint64_t>   seq;            // seqlock, see above
+    uint64_t                blockSeq;
+    int64_t                 stampNs;        // ROS time of the first scan
+    double                  samplePeriod;
+    uint32_t                scans;
+    uint32_t                gapSamples;
+    uint8_t                 layout;         // analogInputBlock::SCAN_MAJOR / CHANNEL_MAJOR
+    uint8_t                 pad[31];
+    // followed by maxScans*channels float32, padded to 64 bytes
+};
+
+struct ShmReaderCursor {
+    std::atomic<int32_t>    pid;            // 0 = free
+    std::atomic<uint64_t>   next;           // next block this reader wants
+    std::atomic<uint64_t>   lost;
+    uint8_t                 pad[40];
+};
+
+struct ShmRingHeader {
+    uint32_t                magic;
+    uint32_t                version;
+    uint32_t                slotCount;
+    uint32_t                channels;
+    uint32_t                maxScans;
+    uint32_t                slotBytes;      // ShmSlot + data, stride between slots
+    uint8_t                 pad0[40];
+    std::atomic<uint64_t>   written;        // blocks completed so far
+    std::atomic<uint32_t>   futex;          // bumped on every commit
+    std::atomic<uint32_t>   waiters;
+    uint8_t                 pad1[48];
+    ShmReaderCursor         readers[NIDAQ_SHM_MAX_READERS];
+    // followed by slotCount slots
+};
+
+// a block mapped in place by ShmRingReader::next()
+struct ShmBlockView {
+    uint64_t        blockSeq;
+    int64_t         stampNs;
+    double          samplePeriod;
+    uint32_t        channels;
+    uint32_t        scans;
+    uint32_t        gapSamples;
+    uint8_t         layout;
+    const float*    data;
+    const ShmSlot*  slot;
+};
+
+class ShmRingWriter {
+public:
+    ShmRingWriter();
+    ~ShmRingWriter();
+
+    // creates (or replaces) /dev/shm/<name>; readers write their cursors
+    // into it, so mode should not give write access beyond who may read
+    bool open(const std::string& name, uint32_t slotCount, uint32_t channels, uint32_t maxScans,
+              unsigned int mode = 0660);
+    void close();
+    bool isOpen() const { return header_ != NULL; }
+
+    // slot for the next block, fill it and commit(); returns its sequence in *blockSeq
+    float* begin(uint64_t* blockSeq);
+    void commit(uint32_t scans, int64_t stampNs, double samplePeriod, uint32_t gapSamples, uint8_t layout);
+
+    uint32_t slotOf(uint64_t blockSeq) const { return blockSeq % header_->slotCount; }
+    // blocks the slowest attached reader is behind, and how many it lost in total
+    uint64_t maxReaderLag(uint64_t* lost) const;
+
+private:
+    ShmSlot* slot(uint64_t blockSeq) const;
+
+    std::string     name_;
+    ShmRingHeader*  header_;
+    size_t          mapped_;
+    uint64_t        current_;
+};
+
+class ShmRingReader {
+public:
+    enum Status { BLOCK, EMPTY, LOST };
+
+    ShmRingReader();
+    ~ShmRingReader();
+
+    // maps an existing ring and claims a cursor; starts with the next block written
+    bool attach(const std::string& name);
+    void detach();
+    bool isAttached() const { return header_ != NULL; }
+
+    // BLOCK: *view is the next block. LOST: the writer lapped this reader,
+    // *lost blocks were skipped and the cursor moved to the oldest one left.
+    Status next(ShmBlockView* view, uint64_t* lost);
+    // still intact after use? false means the data was overwritten meanwhile
+    bool valid(const ShmBlockView& view) const;
+    // sleeps until a new block is committed or timeoutSec passes
+    void wait(double timeoutSec);
+
+    uint32_t channels() const { return header_->channels; }
+
+private:
+    const ShmSlot* slot(uint64_t blockSeq) const;
+
+    ShmRingHeader*  header_;
+    size_t          mapped_;
+    int             cursor_;
+    uint64_t        next_;
+};
+
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef NIDAQ_SIMD_KERNELS_H
+#define NIDAQ_SIMD_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace nidaq {
+
+/*********************************************************************
+*    Layout and conversion kernels between what DAQmx reads/writes
+*    (scan-major, DAQmx_Val_GroupByScanNumber) and what processing
+*    wants (channel-major, one contiguous row per channel).
+*
+*    The implementation is picked once at run time: AVX2 when the CPU
+*    has it, SSE2 on any other x86-64, plain C elsewhere. All kernels
+*    take unaligned pointers and any size; the vector paths handle
+*    4x4 (AVX2) or 2x2 (SSE2) tiles and finish the edges in scalar.
+*********************************************************************/
+
+// out[i] = (float)in[i]
+void narrowF64(const double* in, float* out, size_t n);
+
+// out[i] = gain*in[i] + offset, raw int16 codes to volts
+void scaleI16(const int16_t* in, float* out, size_t n, float gain, float offset);
+
+// in[s*channels + c] (scan-major f64) -> out[c*scans + s] (channel-major f32)
+void deinterleave(const double* in, uint32_t scans, uint32_t channels, float* out);
+
+// in[c*scans + s] (channel-major) -> out[s*channels + c] (scan-major), for AO writes
+void interleave(const double* in, uint32_t scans, uint32_t channels, double* out);
+
+// "avx2", "sse2" or "scalar"
+const char* simdLevel();
+
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef NIDAQ_STREAM_MONITOR_H
+#define NIDAQ_STREAM_MONITOR_H
+
+#include <stdint.h>
+#include <vector>
+#include "ros/ros.h"
+#include "nidaq/streamStats.h"
+
+namespace nidaq {
+
+/*********************************************************************
+*    Subscriber-side loss and delay accounting for one AI stream.
+*
+*    Every received message is reported with the index of its first
+*    scan, the scans it stands for (scans of a block, or the publisher's
+*    decimation for per-scan topics) and its gap_samples. The next
+*    message is expected at index + samples + its own gap; one starting
+*    later lost the difference in transit, one starting earlier arrived
+*    out of order. Latency is receipt minus acquisition_time, binned on
+*    fixed edges from 100 us to 10 s; fill() reports the period since
+*    the last reset() and the percentiles come from the bins.
+*********************************************************************/
+class StreamMonitor {
+public:
+    StreamMonitor();
+
+    void update(uint64_t index, uint64_t samples, uint64_t gapSamples,
+                const ros::Time& acquired, const ros::Time& published, const ros::Time& received);
+    void fill(streamStats* msg) const;
+    void reset();
+
+    uint64_t messages() const { return messages_; }
+
+private:
+    double percentile(double fraction) const;
+
+    bool                    started_;
+    uint64_t                expected_;      // index of the next message, past its gap
+    uint64_t                last_;          // first index of the last message in order
+
+    uint64_t                messages_;
+    uint64_t                samples_;
+    uint64_t                droppedMessages_;
+    uint64_t                droppedSamples_;
+    uint64_t                gapSamples_;
+    uint64_t                reordered_;
+    uint64_t                duplicates_;
+    double                  latencyMin_, latencyMax_, latencySum_;
+    double                  transportMax_, transportSum_;
+    std::vector<double>     edges_;
+    std::vector<uint64_t>   histogram_;     // edges_.size() + 1 bins
+};
+
+}
+
+#endif
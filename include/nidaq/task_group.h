@@ -0,0 +1,143 @@
+#ifndef NIDAQ_TASK_GROUP_H
+#define NIDAQ_TASK_GROUP_H
+
+#include <NIDAQmxBase.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "ros/ros.h"
+#include "nidaq/analogInputBlock.h"
+#include "nidaq/daq_recovery.h"
+#include "nidaq/ring_buffer.h"
+#include "nidaq/rt_profile.h"
+
+namespace nidaq {
+
+/*********************************************************************
+*    DAQmx Base is not thread-safe, so every driver call made by a task
+*    group holds this lock. No group ever waits inside the driver while
+*    holding it: a group sleeps on its own until its samples (or its
+*    buffer space) must be there, then makes a call that returns at
+*    once. A slow group's wait therefore never delays a fast one.
+*********************************************************************/
+class DriverLock {
+public:
+    DriverLock();
+    ~DriverLock();
+private:
+    DriverLock(const DriverLock&);
+    DriverLock& operator=(const DriverLock&);
+};
+
+/*********************************************************************
+*    One independently clocked DAQmx task with its own service thread.
+*
+*    configure() creates the task from the group's parameters
+*    (~<name>/...), start() launches the thread, which applies the
+*    group's ~<name>/rt profile and calls service() until stop().
+*    pause() ends the thread and stops the task but keeps it, so a
+*    paused group can be retuned and started again without the cost
+*    of creating the task anew. A started group must be paused or
+*    stopped before it is deleted: ~TaskGroup() runs after the derived
+*    members are gone, too late for a thread still in service().
+*    Input groups hand filled blocks to the publishing thread through
+*    a single-producer single-consumer queue and get them back through
+*    a second one, so the service thread never allocates. When the
+*    publisher falls behind, blocks are dropped and counted, the group
+*    itself keeps its rate.
+*    The counters belong to the service thread; after each service()
+*    it copies them to a snapshot if the snapshot lock is free, and
+*    stats() returns that copy, so other threads never read them while
+*    they are written and the service thread never waits for a reader.
+*********************************************************************/
+class TaskGroup {
+public:
+    struct Stats {
+        uint64_t    loops;          // service() calls
+        uint64_t    samples;        // scans read or written since start()
+        uint64_t    blocks;         // blocks queued for publishing
+        uint64_t    dropped;        // blocks lost to a full queue
+        double      startSec;       // wall time of start(), for the achieved rate
+        RecoveryStats recovery;
+    };
+
+    TaskGroup(const std::string& name, const std::string& type, int queue);
+    virtual ~TaskGroup();
+
+    // the queues keep their indices on separate cache lines
+    static void* operator new(size_t bytes);
+    static void operator delete(void* p);
+
+    bool configure(const ros::NodeHandle& nh);
+    bool start(sem_t* notify);
+    void pause();
+    void stop();
+
+    // applies changed parameters to a paused group; false when they need a new task
+    virtual bool retune(const ros::NodeHandle& nh) { return false; }
+
+    const std::string& name() const { return name_; }
+    const std::string& type() const { return type_; }
+    bool failed() const { return failed_.load(std::memory_order_acquire); }
+    bool running() const { return running_.load(std::memory_order_acquire); }
+    Stats stats() const;                    // any thread
+    virtual double achievedRate() const;   // scans/s since start()
+    double rate() const { return rate_; }
+
+    // publishing thread: take a filled block, give it back when published
+    analogInputBlock* pop();
+    void recycle(analogInputBlock* block);
+
+protected:
+    virtual bool setup(const ros::NodeHandle& nh) = 0;     // creates the task
+    virtual bool begin() = 0;       // on the service thread, before the first service()
+    virtual bool service() = 0;     // false stops the group
+    void allocateBlocks(size_t channels, size_t scans);    // one per queue slot
+    analogInputBlock* acquire();
+    void submit(analogInputBlock* block);
+    void sleepFor(double seconds);
+    void fail(int32 error);
+
+    TaskHandle          task_;
+    double              rate_;
+    Stats               stats_;         // service thread only
+    RtProfile           rt_;
+
+private:
+    static void* threadMain(void* arg);
+    void publishStats(bool wait);
+
+    std::string                     name_;
+    std::string                     type_;
+    pthread_t                       thread_;
+    bool                            started_;
+    std::atomic<bool>               failed_;
+    std::atomic<bool>               running_;
+    sem_t*                          notify_;
+    mutable pthread_mutex_t         statsLock_;
+    Stats                           snapshot_;
+    std::vector<analogInputBlock>   blocks_;
+    RingBuffer<analogInputBlock*>   filled_;
+    RingBuffer<analogInputBlock*>   free_;
+};
+
+/*********************************************************************
+*    Builds a group from ~<name>/type:
+*        ai   continuous AI, blocks published (~channels, ~rate,
+*             ~block_size, ~queue, ~min, ~max)
+*        ao   regenerated waveforms (~channels, ~rate, ~scans,
+*             ~waveforms: one spec per channel, see waveform.h), or a
+*             file streamed chunk by chunk (~file, ~chunk, ~loop);
+*             ~amplitude, if set, replaces the amplitude of every
+*             non-DC waveform
+*        co   continuous pulse train (~counter, ~frequency, ~duty)
+*    Returns NULL (logged) for an unknown type or a failed configure.
+*********************************************************************/
+TaskGroup* createTaskGroup(const std::string& name, const ros::NodeHandle& nh);
+
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef NIDAQ_THREAD_POOL_H
+#define NIDAQ_THREAD_POOL_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+namespace nidaq {
+
+/*********************************************************************
+*    Fork-join pool for splitting one block into independent tasks
+*    (one per channel or channel group).
+*
+*    run(fn, ctx, count) calls fn(ctx, i) for i in [0, count) and
+*    returns when all calls are done; the calling thread works too.
+*    The index range is dealt out in contiguous slices, one per
+*    thread. A thread takes from the front of its own slice and, when
+*    that is empty, steals the back half of the fullest other slice,
+*    so uneven tasks still keep every core busy. Each task writes only
+*    its own part of the output, so the result comes out in order
+*    without any reassembly. Nothing is allocated per run().
+*********************************************************************/
+class ThreadPool {
+public:
+    typedef void (*TaskFn)(void* ctx, size_t index);
+
+    explicit ThreadPool(int threads);   // total, the caller included; 0: one per CPU
+    ~ThreadPool();
+
+    void run(TaskFn fn, void* ctx, size_t count);
+    int threads() const { return (int)slices_.size(); }
+
+private:
+    struct Slice {
+        pthread_mutex_t lock;
+        size_t          begin;
+        size_t          end;
+        char            pad[64];    // slices of different threads on separate lines
+    };
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    static void* workerMain(void* arg);
+    void work(size_t self);
+    bool take(size_t slice, size_t* index);
+    bool steal(size_t self, size_t* index);
+
+    std::vector<Slice>      slices_;
+    std::vector<pthread_t>  workers_;
+    pthread_mutex_t         lock_;
+    pthread_cond_t          wake_;      // workers: a new run() or shutdown
+    pthread_cond_t          idle_;      // caller: the last worker left the run
+    unsigned long           generation_;
+    int                     active_;    // workers still inside the current run
+    bool                    stopping_;
+    TaskFn                  fn_;
+    void*                   ctx_;
+    std::atomic<size_t>     next_;      // hands out worker slots
+};
+
+}
+
+#endif
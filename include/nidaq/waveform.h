@@ -0,0 +1,42 @@
+#ifndef NIDAQ_WAVEFORM_H
+#define NIDAQ_WAVEFORM_H
+
+#include <stdint.h>
+#include <string>
+#include "nidaq/waveformDescriptor.h"
+
+namespace nidaq {
+
+/*********************************************************************
+*    Periodic AO waveform for one channel of a multi-channel task.
+*    Written as "shape:amplitude[:phase_deg[:cycles]]", e.g.
+*        "sine:2.5"        2.5 V sine, one period per buffer
+*        "cosine:2.5"      the quadrature partner of "sine:2.5"
+*        "sine:1:90:4"     1 V sine, +90 degrees, 4 periods per buffer
+*        "dc:5"            constant 5 V
+*    All channels of a task share its sample clock, so waveforms with
+*    a whole number of cycles per buffer stay phase-locked forever.
+*********************************************************************/
+struct WaveformSpec {
+    enum Shape { SINE, COSINE, DC };
+
+    Shape   shape;
+    double  amplitude;      // V, the level for DC
+    double  phase;          // radians
+    double  cycles;         // periods per buffer
+};
+
+// false (and logged) on a malformed spec: unknown shape, a field that
+// is not a number, cycles <= 0 or more than four fields
+bool parseWaveform(const std::string& text, WaveformSpec* spec);
+void fillWaveform(const WaveformSpec& spec, double* out, uint32_t n);
+
+// 64-bit FNV-1a over the samples' bytes, the descriptor's buffer_hash
+uint64_t waveformHash(const double* data, uint32_t n);
+
+// header.stamp, channel and start_time are left to the caller
+void describeWaveform(const WaveformSpec& spec, double rate, const double* data, uint32_t n, waveformDescriptor* msg);
+
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef NIDAQ_WAVEFORM_FILE_H
+#define NIDAQ_WAVEFORM_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace nidaq {
+
+/*********************************************************************
+*    Waveform file for AO playback: a 64-byte little-endian header
+*    followed by scan-major samples (scan 0 ch 0, scan 0 ch 1, ...),
+*    either float64 volts or int16 codes with volts = raw*scale+offset.
+*    scripts/write_waveform.py writes them.
+*********************************************************************/
+#define NIDAQ_WAVE_MAGIC        "NIDQWAV1"
+
+enum WaveformFormat { WAVE_FLOAT64 = 0, WAVE_INT16 = 1 };
+
+struct WaveformFileHeader {
+    char        magic[8];
+    uint32_t    format;         // WaveformFormat
+    uint32_t    channels;
+    double      sampleRate;     // S/s the file was made for
+    double      scale;          // int16 only
+    double      offset;
+    uint64_t    scans;
+    uint64_t    dataOffset;     // bytes from the start of the file to scan 0
+    uint8_t     reserved[8];
+};
+
+/*********************************************************************
+*    The file is mapped read-only, never read into memory as a whole:
+*    prefetch() asks the kernel to start reading the next chunks ahead
+*    (MADV_WILLNEED) and release() drops the ones already played
+*    (MADV_DONTNEED), so resident memory stays a few chunks deep
+*    however long the file is.
+*********************************************************************/
+class WaveformFile {
+public:
+    WaveformFile();
+    ~WaveformFile();
+
+    bool open(const std::string& path);
+    void close();
+
+    const WaveformFileHeader& header() const { return header_; }
+    uint64_t scans() const { return header_.scans; }
+    uint32_t channels() const { return header_.channels; }
+
+    // scans [first, first+count) in volts, scan-major; the range must lie inside the file
+    void read(uint64_t first, uint32_t count, double* out) const;
+    void prefetch(uint64_t first, uint64_t count) const;
+    void release(uint64_t first, uint64_t count) const;
+
+private:
+    void advise(uint64_t first, uint64_t count, int advice, bool inward) const;
+
+    WaveformFileHeader  header_;
+    const uint8_t*      map_;
+    size_t              mapped_;
+    size_t              scanBytes_;
+};
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+#!/usr/bin/env python
+"""Writes waveform files for nidaqAOStream (format: include/nidaq/waveform_file.h).
+
+As a module:
+    write_waveform("sweep.wav64", samples, rate)      # samples: scans x channels, volts
+
+From the shell, a test signal:
+    write_waveform.py out.wav64 --rate 100000 --seconds 600 --chirp 10:5000 --amplitude 2
+    write_waveform.py out.wav64 --from-npy recorded.npy --rate 50000 --int16
+"""
+
+import argparse
+import struct
+
+import numpy as np
+
+MAGIC = b"NIDQWAV1"
+FLOAT64, INT16 = 0, 1
+HEADER = struct.Struct("<8sIIdddQQ8x")      # 64 bytes
+
+
+def write_waveform(path, samples, rate, int16=False, full_scale=10.0, block=1 << 20):
+    """samples: array (scans, channels) or (scans,) in volts, any array-like incl. np.memmap."""
+    samples = np.asarray(samples)
+    if samples.ndim == 1:
+        samples = samples[:, None]
+    scans, channels = samples.shape
+    scale = full_scale / 32767.0 if int16 else 1.0
+    with open(path, "wb") as f:
+        f.write(HEADER.pack(MAGIC, INT16 if int16 else FLOAT64, channels, float(rate),
+                            scale, 0.0, scans, HEADER.size))
+        for start in range(0, scans, block):
+            chunk = samples[start:start + block]
+            if int16:
+                chunk = np.clip(np.round(chunk / scale), -32768, 32767).astype("<i2")
+            else:
+                chunk = chunk.astype("<f8")
+            f.write(np.ascontiguousarray(chunk).tobytes())
+
+
+def chirp(rate, seconds, f0, f1, amplitude, block=1 << 20):
+    """Linear chirp, generated block by block so long files never sit in memory at once."""
+    scans = int(rate * seconds)
+    k = (f1 - f0) / seconds
+    for start in range(0, scans, block):
+        t = np.arange(start, min(start + block, scans)) / rate
+        yield amplitude * np.sin(2 * np.pi * (f0 * t + 0.5 * k * t * t))
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument("output")
+    p.add_argument("--rate", type=float, required=True)
+    p.add_argument("--int16", action="store_true", help="store int16 codes instead of float64 volts")
+    p.add_argument("--full-scale", type=float, default=10.0, help="volts at int16 full scale")
+    p.add_argument("--from-npy", help="scans x channels array in volts")
+    p.add_argument("--seconds", type=float, default=10.0)
+    p.add_argument("--chirp", default="10:1000", help="f0:f1 in Hz")
+    p.add_argument("--amplitude", type=float, default=1.0)
+    a = p.parse_args()
+
+    if a.from_npy:
+        write_waveform(a.output, np.load(a.from_npy, mmap_mode="r"), a.rate, a.int16, a.full_scale)
+        return
+
+    f0, f1 = (float(x) for x in a.chirp.split(":"))
+    scans = int(a.rate * a.seconds)
+    scale = a.full_scale / 32767.0 if a.int16 else 1.0
+    with open(a.output, "wb") as f:
+        f.write(HEADER.pack(MAGIC, INT16 if a.int16 else FLOAT64, 1, a.rate, scale, 0.0, scans, HEADER.size))
+        for block in chirp(a.rate, a.seconds, f0, f1, a.amplitude):
+            if a.int16:
+                f.write(np.clip(np.round(block / scale), -32768, 32767).astype("<i2").tobytes())
+            else:
+                f.write(block.astype("<f8").tobytes())
+
+
+if __name__ == "__main__":
+    main()
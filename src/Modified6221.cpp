@@ -52,6 +52,16 @@
 #include <signal.h>
 #include "ros/console.h"
 #include "nidaq/analogInput.h"
+#include "nidaq/kernels.h"
+#include "nidaq/control_law.h"
+#include "nidaq/waveform.h"
+#include "nidaq/simd_kernels.h"
+#include "nidaq/rt_profile.h"
+#include "nidaq/loop_scheduler.h"
+#include "nidaq/sample_clock.h"
+#include "nidaq/daq_recovery.h"
+#include "nidaq/daqDiagnostics.h"
+#include <std_msgs/Float64.h>
 #include <stdio.h>
 #include <time.h>
 #include <stdlib.h>
@@ -65,8 +75,7 @@
 using namespace ros;
 
     static TaskHandle  taskHandleAI = 0;
-    static TaskHandle  taskHandleAO = 0;
-    static TaskHandle  taskHandleHAO = 0;
+    static TaskHandle  taskHandleAO = 0;	//ao0 and ao1 in one task
 
 void my_handler(int s){
     printf("Caught signal %d\n",s);
@@ -90,18 +99,32 @@ void my_handler(int s){
 
 int main(int argc, char *argv[])
 { 
-    float64 MINi = 10;
-    float64 MAXi = 0;
-
     float64 common_rate = 5000;		//80Hz
     float64 acqui_rate = 10;		//1Hz
     float64 wave_rate = common_rate;
 
     init(argc, argv, "Modified6221");
     NodeHandle n;
+    NodeHandle pn("~");
+
+    // Real-time profile, off unless ~rt/enabled is set
+    nidaq::RtProfile rt;
+    nidaq::loadRtProfile(pn, &rt);
+
+    // Loop pacing: absolute deadlines, or the AI read itself ("hardware")
+    double loopRate;
+    std::string loopPolicy, loopPacing;
+    pn.param("loop_rate", loopRate, 10000.0);
+    pn.param("loop_policy", loopPolicy, std::string("catch_up"));
+    pn.param("loop_pacing", loopPacing, std::string("clock"));
+    bool hardwarePaced = (loopPacing == "hardware");
+    nidaq::LoopScheduler scheduler(loopRate, nidaq::LoopScheduler::parsePolicy(loopPolicy));
+    int64_t lastReport;
+    uInt32 backlog = 0;
 
     Publisher nidaq_pub = n.advertise <nidaq::analogInput> ("Modified6221", 1);    
-    Rate loop_rate(10000);
+    Publisher skew_pub = n.advertise <std_msgs::Float64> ("Modified6221/clock_skew", 10);
+    Publisher diag_pub = n.advertise <nidaq::daqDiagnostics> ("Modified6221/diagnostics", 10);
 
     // Task parameters
     int32       error = 0;
@@ -111,8 +134,8 @@ int main(int argc, char *argv[])
 
     // Channel parameters
     char        chanAI[] = "Dev2/ai0,Dev2/ai1,Dev2/ai2,Dev2/ai3,Dev2/ai4,Dev2/ai5,Dev2/ai6,Dev2/ai7,Dev2/ai8,Dev2/ai9,Dev2/ai10,Dev2/ai11,Dev2/ai12,Dev2/ai13,Dev2/ai14,Dev2/ai15";	//get 0-15
-    char        chanAO[] = "Dev2/ao1";		//gen 5V
-    char	chanHAO[] = "Dev2/ao0";		//gen sin wave
+    char        chanAO[] = "Dev2/ao0:1";	//ao0 sin wave, ao1 5V
+    #define     aoChannels 2
     float64     maxAI = 10.0;
     float64     minAI = -10.0;
     float64     maxAO = 5.0;
@@ -122,107 +145,178 @@ int main(int argc, char *argv[])
     #define     bufferSize (uInt32)512
     char        clockSource[] = "OnboardClock";
     uInt64      samplesPerChanAI = 1;
-    uInt64      samplesPerChanAO = 1;
-    uInt64      samplesPerChanHAO = bufferSize;
+    uInt64      samplesPerChanAO = bufferSize;
 
     // Data read parameters
     #define     bufferSize16 (uInt32)16
-    float64     dataAI[bufferSize16];	//data read on AI, and published.
-    float64	data[bufferSize];	//sine wave with samplesPerChanHAO num of samples
-    float64 	dataAO = 5;		//5V
+    float64     *dataAI;	//data read on AI, and published.
+    float64	*data;		//ao0 row then ao1 row, samplesPerChanAO each
+    float64	*dataAO;	//the same, interleaved by scan for the write
+    size_t	dataAIMapped, dataMapped, dataAOMapped;
+    std::string waveAO0, waveAO1;
+    nidaq::WaveformSpec specAO0, specAO1;
+    pn.param("ao0_waveform", waveAO0, std::string("sine:2.5"));
+    pn.param("ao1_waveform", waveAO1, std::string("dc:5"));
+    if(!nidaq::parseWaveform(waveAO0, &specAO0) || !nidaq::parseWaveform(waveAO1, &specAO1))
+        return 1;
     int32       pointsToRead = bufferSize16;
     int32       pointsRead;
     float64     timeout = 10000.0;
     int32       totalRead = 0;
+    uInt64      scansRead = 0;	//sample index of the next scan
+    nidaq::SampleClock sampleClock(nidaq::boardSampleRate(acqui_rate));
+    std_msgs::Float64 skew;
+
+    // Overrun/underrun recovery
+    nidaq::RecoveryStats recovery;
+    nidaq::daqDiagnostics diagnostics;
+    uInt64      pendingGap = 0;	//scans lost, reported with the next message
+    Time        resumed;
+    nidaq::resetRecoveryStats(&recovery);
+
+    // AI -> AO control law, ~control_law (default: the amplitude law)
+    nidaq::ControlLoop control;
+    nidaq::ControlInput controlIn;
+    bool        writeAO;	//push every new buffer to ao0, otherwise only computed
+    double      lastStep = 0;
+    pn.param("write_ao", writeAO, false);
+    if(!control.configure(pn, bufferSize, bufferSize16))
+        return 1;
     int32       pointsWrittenAO;
-    int32       pointsWrittenHAO;
     float64     timeoutAO = 10.0;
 
-    for(int i=0; i<bufferSize; i++){
-        data[i] = 2.5*sin((double)i*2.0*PI/(double)bufferSize);
+    if(rt.enabled && rt.jitterLoops > 0)
+        nidaq::jitterPrint("rt: jitter before profile", nidaq::measureJitter(loopRate, rt.jitterLoops));
+    nidaq::applyRtProfile(rt);
+    if(rt.enabled && rt.jitterLoops > 0)
+        nidaq::jitterPrint("rt: jitter after profile", nidaq::measureJitter(loopRate, rt.jitterLoops));
+
+    // sample buffers are allocated after mlockall so they are locked and prefaulted
+    dataAI = (float64 *)nidaq::rtAlloc(bufferSize*sizeof(float64), rt, &dataAIMapped);
+    data = (float64 *)nidaq::rtAlloc(aoChannels*bufferSize*sizeof(float64), rt, &dataMapped);
+    dataAO = (float64 *)nidaq::rtAlloc(aoChannels*bufferSize*sizeof(float64), rt, &dataAOMapped);
+    if(dataAI == NULL || data == NULL || dataAO == NULL){
+        ROS_ERROR("Cannot allocate sample buffers");
+        return 1;
     }
 
+    nidaq::fillWaveform(specAO0, data, bufferSize);
+    nidaq::fillWaveform(specAO1, data + bufferSize, bufferSize);
+    nidaq::interleave(data, bufferSize, aoChannels, dataAO);
+
 
     ROS_INFO("NIDAQmx Base node started");
     DAQmxErrChk(DAQmxBaseCreateTask("", &taskHandleAI));
     DAQmxErrChk(DAQmxBaseCreateTask("", &taskHandleAO));	 
-    DAQmxErrChk(DAQmxBaseCreateTask("", &taskHandleHAO));
 
     DAQmxErrChk (DAQmxBaseCreateAIVoltageChan(taskHandleAI, chanAI, "", DAQmx_Val_RSE, minAI, maxAI, DAQmx_Val_Volts, NULL));
-    DAQmxErrChk (DAQmxBaseCreateAOVoltageChan(taskHandleAO, chanAO, "", 0, maxAO, DAQmx_Val_Volts, NULL));
-    DAQmxErrChk (DAQmxBaseCreateAOVoltageChan(taskHandleHAO, chanHAO, "", minAO, maxAO, DAQmx_Val_Volts, NULL));
+    DAQmxErrChk (DAQmxBaseCreateAOVoltageChan(taskHandleAO, chanAO, "", minAO, maxAO, DAQmx_Val_Volts, NULL));
 
-//start 5V
-    DAQmxErrChk (DAQmxBaseCfgSampClkTiming(taskHandleAO, clockSource, 2000, DAQmx_Val_Rising, DAQmx_Val_ContSamps, samplesPerChanAO));
-    DAQmxErrChk (DAQmxBaseWriteAnalogF64(taskHandleAO, samplesPerChanAO, 0, timeoutAO, DAQmx_Val_GroupByChannel, &dataAO, &pointsWrittenAO,NULL));
+//Wave Sine on ao0, 5V on ao1: one clock, one buffer, one write
+    DAQmxErrChk (DAQmxBaseCfgSampClkTiming(taskHandleAO, clockSource, wave_rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, samplesPerChanAO));
+    DAQmxErrChk (DAQmxBaseWriteAnalogF64(taskHandleAO, samplesPerChanAO, 0, timeoutAO, DAQmx_Val_GroupByScanNumber, dataAO, &pointsWrittenAO, NULL));
     DAQmxErrChk (DAQmxBaseStartTask(taskHandleAO));
-    ROS_INFO("NIDAQmx 5V");
-	
-//Wave Sine
-    DAQmxErrChk (DAQmxBaseCfgSampClkTiming(taskHandleHAO, clockSource, wave_rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, samplesPerChanHAO));
-    ROS_INFO("NIDAQmx Sine");
-    DAQmxErrChk (DAQmxBaseWriteAnalogF64(taskHandleHAO, samplesPerChanHAO, 0, timeout, DAQmx_Val_GroupByChannel, data, &pointsWrittenHAO, NULL));
-    ROS_INFO("NIDAQmx Sine");
-    DAQmxErrChk (DAQmxBaseStartTask(taskHandleHAO));
-    ROS_INFO("NIDAQmx Sine");
+    ROS_INFO("NIDAQmx AO (ao0 %s, ao1 %s)", waveAO0.c_str(), waveAO1.c_str());
 
     DAQmxErrChk (DAQmxBaseCfgSampClkTiming(taskHandleAI, clockSource, acqui_rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, samplesPerChanAI));
     DAQmxErrChk (DAQmxBaseStartTask(taskHandleAI));
     ROS_INFO("NIDAQmx AI");
 
+    scheduler.start();
+    lastReport = nidaq::monotonicNs();
     while(!done) {
 	//stop AO in here, just to relaunch it with new data
-	//DAQmxErrChk(DAQmxBaseStopTask(taskHandleHAO));
-	//DAQmxErrChk (DAQmxBaseWriteAnalogF64(taskHandleHAO, samplesPerChanHAO, 0, timeout, DAQmx_Val_GroupByChannel, data, &pointsWrittenHAO, NULL));
-	//DAQmxErrChk (DAQmxBaseStartTask(taskHandleHAO));
+	//DAQmxErrChk(DAQmxBaseStopTask(taskHandleAO));
+	//DAQmxErrChk (DAQmxBaseWriteAnalogF64(taskHandleAO, samplesPerChanAO, 0, timeout, DAQmx_Val_GroupByScanNumber, dataAO, &pointsWrittenAO, NULL));
+	//DAQmxErrChk (DAQmxBaseStartTask(taskHandleAO));
 
 	signal(SIGINT, my_handler);
-	DAQmxErrChk (DAQmxBaseIsTaskDone(taskHandleAO, &done));
 
-	ROS_INFO("Still running");
-        DAQmxErrChk (DAQmxBaseReadAnalogF64(taskHandleAI, pointsToRead, timeout, DAQmx_Val_GroupByScanNumber, dataAI, bufferSize, &pointsRead, NULL));
+	//an AO underrun restarts that task only, AI keeps going
+	error = DAQmxBaseIsTaskDone(taskHandleAO, &done);
+	if(DAQmxFailed(error)){
+	    if(!nidaq::recoverTask(taskHandleAO, error, &recovery))
+	        goto Error;
+	    done = 0;
+	}
+	error = 0;
+
+        error = DAQmxBaseReadAnalogF64(taskHandleAI, pointsToRead, timeout, DAQmx_Val_GroupByScanNumber, dataAI, bufferSize, &pointsRead, NULL);
+        if(DAQmxFailed(error)){
+            if(!nidaq::recoverTask(taskHandleAI, error, &recovery))
+                goto Error;
+            if(nidaq::classifyDaqError(error) == nidaq::DAQ_OVERRUN){
+                //everything since the last delivered scan is gone; skip the
+                //sample index ahead so stamps and indices stay on the time axis
+                resumed = Time::now();
+                uInt64 gap = (uInt64)((resumed - sampleClock.stamp(scansRead)).toSec()*acqui_rate + 0.5);
+                scansRead += gap;
+                pendingGap += gap;
+                recovery.gapSamples += gap;
+                sampleClock.reset(scansRead, resumed);
+            }
+            error = 0;
+            continue;
+        }
+        DAQmxErrChk (DAQmxBaseGetReadAttribute(taskHandleAI, DAQmx_Read_AvailSampPerChan, &backlog));
+        sampleClock.update(scansRead + pointsRead + backlog, Time::now());
         totalRead += pointsRead;
 
         nidaq::analogInput msg;
-	msg.header.stamp = Time::now();
-
-	msg.a0 = dataAI[0];
-	msg.a1 = dataAI[1];
-	msg.a2 = dataAI[2];
-	msg.a3 = dataAI[3];
-	msg.a4 = dataAI[4];
-	msg.a5 = dataAI[5];
-	msg.a6 = dataAI[6];
-	msg.a7 = dataAI[7];
-	msg.a8 = dataAI[8];
-	msg.a9 = dataAI[9];
-	msg.a10 = dataAI[10];
-	msg.a11 = dataAI[11];
-	msg.a12 = dataAI[12];
-	msg.a13 = dataAI[13];
-	msg.a14 = dataAI[14];
-	msg.a15 = dataAI[15];
-
-	if(dataAI[0] > MAXi)
-	    MAXi = dataAI[0];
-
-	if(dataAI[0] < MINi)
-	    MINi = dataAI[0];
+	msg.header.stamp = sampleClock.stamp(scansRead);
+	msg.gap_samples = pendingGap;
+	msg.sample_index = scansRead;
+	msg.acquisition_time = msg.header.stamp;
+	pendingGap = 0;
+	scansRead += pointsRead;
+
+	nidaq::packScan(dataAI, &msg);
 
 	//wave_rate is dependent on a0;
 	//wave_rate = (dataAI[0]/MAXi) * common_rate;
 
-    for(int i=0; i<bufferSize; i++){
-        data[i] = 2.5*((dataAI[0]-MINi)/(MAXi - MINi))*sin((double)i*2.0*PI/(double)bufferSize);
-    }
-	printf("%f ", data[128]);
-	printf("MIN %fMAX %f\n\n", MINi, MAXi);
+	controlIn.block = dataAI;
+	controlIn.scans = pointsRead;
+	controlIn.channels = 16;
+	controlIn.scan = dataAI + (pointsRead - 1)*16;
+	controlIn.time = sampleClock.stamp(scansRead - 1).toSec();
+	controlIn.dt = lastStep > 0 ? controlIn.time - lastStep : 0;
+	lastStep = controlIn.time;
+	control.step(controlIn, data);
+
+	if(writeAO){
+	    //ao1 keeps its row, both outputs change with the same write
+	    nidaq::interleave(data, bufferSize, aoChannels, dataAO);
+	    DAQmxErrChk (DAQmxBaseStopTask(taskHandleAO));
+	    DAQmxErrChk (DAQmxBaseWriteAnalogF64(taskHandleAO, samplesPerChanAO, 0, timeoutAO, DAQmx_Val_GroupByScanNumber, dataAO, &pointsWrittenAO, NULL));
+	    DAQmxErrChk (DAQmxBaseStartTask(taskHandleAO));
+	}
 
 	totalRead += pointsRead;
 		
+	msg.publish_time = Time::now();
 	nidaq_pub.publish(msg);
 	spinOnce();
-	loop_rate.sleep();
+
+	skew.data = sampleClock.skewPpm();
+	skew_pub.publish(skew);
+
+	if(hardwarePaced){
+	    //the blocking read paced this iteration, whatever is left in the buffer is lateness
+	    scheduler.hardwareTick(backlog, acqui_rate, pointsToRead);
+	}else{
+	    scheduler.wait();
+	}
+
+	if(nidaq::monotonicNs() - lastReport >= 1000000000LL){
+	    scheduler.printStats("loop");
+	    scheduler.resetStats();
+	    control.printStats("control");
+	    control.resetStats();
+	    nidaq::fillDiagnostics(recovery, &diagnostics);
+	    diag_pub.publish(diagnostics);
+	    lastReport = nidaq::monotonicNs();
+	}
     }
     
 Error:
@@ -234,10 +328,11 @@ Error:
         DAQmxBaseClearTask (taskHandleAO);
         DAQmxBaseStopTask (taskHandleAI);
         DAQmxBaseClearTask (taskHandleAI);
-        DAQmxBaseStopTask (taskHandleHAO);
-        DAQmxBaseClearTask (taskHandleHAO);
     }
     if( DAQmxFailed(error) )
 		printf ("DAQmxBase Error %ld: %s\n", error, errBuff);
+    nidaq::rtFree(dataAI, dataAIMapped);
+    nidaq::rtFree(data, dataMapped);
+    nidaq::rtFree(dataAO, dataAOMapped);
     return 0;
 }
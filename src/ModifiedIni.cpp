@@ -0,0 +1,261 @@
+/*********************************************************************
+*
+* ANSI C Example program:
+*    contAcquireNChan.c
+*
+* Example Category:
+*    AI
+*
+* Description:
+*    This example demonstrates how to continuously acquire data on
+*    multiple channels using the DAQ device's internal clock.
+*
+* Instructions for Running:
+*    1. Select the physical channels to correspond to where your
+*       signals are input on the DAQ device.
+*    2. Enter the minimum and maximum voltage range.
+*    Note: For better accuracy try to match the input range to the
+*          expected voltage level of the measured signal.
+*    3. Set the rate of the acquisition. Also set the Samples to Read
+*       control. This will determine how many samples are read each
+*       time the while loop iterates. This also determines how many
+*       points are plotted on the graph each iteration.
+*    Note: The rate should be at least twice as fast as the maximum
+*          frequency component of the signal being acquired.
+*
+* Steps:
+*    1. Create a task.
+*    2. Create an analog input voltage channel.
+*    3. Set the rate for the sample clock. Additionally, define the
+*       sample mode to be continuous.
+*    4. Call the Start function to start the acquistion.
+*    5. Read the data in a loop until 10 seconds or an
+*       error occurs.
+*    6. Call the Clear Task function to clear the task.
+*    7. Display an error if any.
+*
+* I/O Connections Overview:
+*    Make sure your signal input terminal matches the Physical
+*    Channel I/O control. Also, make sure your analog trigger
+*    terminal matches the Trigger Source Control. For further
+*    connection information, refer to your hardware reference manual.
+*
+* Recommended Use:
+*    1. Call Configure and Start functions.
+*    2. Call Read function in a loop.
+*    3. Call Stop function at the end.
+*
+*********************************************************************/
+
+#include <NIDAQmxBase.h>
+#include "ros/ros.h"
+#include <signal.h>
+#include "ros/console.h"
+#include "nidaq/analogInput.h"
+#include "nidaq/kernels.h"
+#include "nidaq/control_law.h"
+#include "nidaq/waveform.h"
+#include "nidaq/simd_kernels.h"
+#include "nidaq/loop_scheduler.h"
+#include <stdio.h>
+#include <time.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "NIDAQmxBase.h"
+#include <math.h>
+
+#define PI	3.1415926535
+#define DAQmxErrChk(functionCall) { if( DAQmxFailed(error=(functionCall)) ) { goto Error; } }
+
+using namespace ros;
+
+    static TaskHandle  taskHandleAI = 0;
+    static TaskHandle  taskHandleAO = 0;	//ao0 and ao1 in one task
+
+void my_handler(int s){
+    printf("Caught signal %d\n",s);
+    exit(1); 
+}
+
+/*********************************************************************
+*    Recalculates the number in max_analog_value to enable simple 
+*    self-adjustment 
+*********************************************************************/
+//void my_callback(const nidaq::analogInput& msg)
+//{
+//    ROS_INFO("I heard on node A0: [%f]", msg.a0);
+//    if(msg.a0 > max_analog_value)
+//        max_analog_value = msg.a0;
+//    output_sampling_rate = (msg.a0 / max_analog_value) * max_sampling_rate;
+//}
+
+
+//THREADS? -> different frequencies
+
+int main(int argc, char *argv[])
+{ 
+    float64 common_rate = 5000;		//80Hz
+    float64 acqui_rate = 10000;		//1Hz
+    float64 wave_rate = 200000;
+
+    init(argc, argv, "ModifiedIni");
+    NodeHandle n;
+    NodeHandle pn("~");
+
+    Publisher nidaq_pub = n.advertise <nidaq::analogInput> ("ModifiedIni", 1);    
+
+    // Loop pacing: absolute deadlines; "hardware" needs a sample clock this node does not have
+    double loopRate;
+    std::string loopPolicy, loopPacing;
+    pn.param("loop_rate", loopRate, 10000.0);
+    pn.param("loop_policy", loopPolicy, std::string("catch_up"));
+    pn.param("loop_pacing", loopPacing, std::string("clock"));
+    if(loopPacing == "hardware")
+        ROS_WARN("ModifiedIni reads AI on demand, there is no sample clock to pace on; using clock pacing");
+    nidaq::LoopScheduler scheduler(loopRate, nidaq::LoopScheduler::parsePolicy(loopPolicy));
+    int64_t lastReport;
+    Time readStart;
+
+    // Task parameters
+    int32       error = 0;
+    char        errBuff[2048]={'\0'};
+    int32       i,j;
+    bool32      done=0;
+
+    // Channel parameters
+    char        chanAI[] = "Dev1/ai0:15";	//get 0-15
+    char        chanAO[] = "Dev1/ao0:1";	//ao0 sin wave, ao1 5V
+    #define     aoChannels 2
+    float64     maxAI = 10.0;
+    float64     minAI = -10.0;
+    float64     maxAO = 5.0;
+    float64     minAO = -5.0;
+
+    // Timing parameters
+    #define     bufferSize (uInt32)512
+    char        clockSource[] = "OnboardClock";
+    uInt64      samplesPerChanAI = 1;
+    uInt64      samplesPerChanAO = bufferSize;
+
+    uInt64 	freqUpd = 10;
+    uInt64 	counter = 0;
+
+    // Data read parameters
+    #define     aiChannels (uInt32)16
+    float64     dataAI[aiChannels];	//one scan of ai0:15, read on AI and published.
+    float64	data[aoChannels*bufferSize];	//ao0 row then ao1 row, samplesPerChanAO each
+    float64	dataAO[aoChannels*bufferSize];	//the same, interleaved by scan for the write
+    std::string waveAO0, waveAO1;
+    nidaq::WaveformSpec specAO0, specAO1;
+    pn.param("ao0_waveform", waveAO0, std::string("sine:2.5"));
+    pn.param("ao1_waveform", waveAO1, std::string("dc:5"));
+    if(!nidaq::parseWaveform(waveAO0, &specAO0) || !nidaq::parseWaveform(waveAO1, &specAO1))
+        return 1;
+    int32       pointsToRead = 1;	//the AI task is untimed: one scan per read
+    int32       pointsRead;
+    float64     timeout = 0.1;
+    uInt64      totalRead = 0;	//scans read so far, the next one's sample_index
+    int32       pointsWrittenAO;
+    float64     timeoutAO = 0.1;
+
+    // AI -> AO control law, ~control_law (default: the amplitude law)
+    nidaq::ControlLoop control;
+    nidaq::ControlInput controlIn;
+    double      lastStep = 0;
+    if(!control.configure(pn, bufferSize, aiChannels))
+        return 1;
+
+    nidaq::fillWaveform(specAO0, data, bufferSize);
+    nidaq::fillWaveform(specAO1, data + bufferSize, bufferSize);
+    nidaq::interleave(data, bufferSize, aoChannels, dataAO);
+
+    ROS_INFO("NIDAQmx Base node started");
+    DAQmxErrChk(DAQmxBaseCreateTask("", &taskHandleAI));
+    DAQmxErrChk(DAQmxBaseCreateTask("", &taskHandleAO));	 
+
+    DAQmxErrChk (DAQmxBaseCreateAIVoltageChan(taskHandleAI, chanAI, "", DAQmx_Val_RSE, minAI, maxAI, DAQmx_Val_Volts, NULL));
+    DAQmxErrChk (DAQmxBaseCreateAOVoltageChan(taskHandleAO, chanAO, "", minAO, maxAO, DAQmx_Val_Volts, NULL));
+
+//Wave Sine on ao0, 5V on ao1: one clock, one buffer, one write
+    DAQmxErrChk (DAQmxBaseCfgSampClkTiming(taskHandleAO, clockSource, wave_rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, samplesPerChanAO));
+    DAQmxErrChk (DAQmxBaseWriteAnalogF64(taskHandleAO, samplesPerChanAO, 0, timeoutAO, DAQmx_Val_GroupByScanNumber, dataAO, &pointsWrittenAO, NULL));
+    DAQmxErrChk (DAQmxBaseStartTask(taskHandleAO));
+    ROS_INFO("NIDAQmx AO (ao0 %s, ao1 %s)", waveAO0.c_str(), waveAO1.c_str());
+
+    //DAQmxErrChk (DAQmxBaseCfgSampClkTiming(taskHandleAI, clockSource, acqui_rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, samplesPerChanAI));
+    DAQmxErrChk (DAQmxBaseStartTask(taskHandleAI));
+    ROS_INFO("NIDAQmx AI");
+
+    scheduler.start();
+    lastReport = nidaq::monotonicNs();
+    while(!done) {
+	counter ++;
+
+	if(counter >= freqUpd){
+	    counter = 0;
+	    //stop AO in here, just to relaunch it with new data
+	    //ao1 keeps its row, both outputs change with the same write
+	    nidaq::interleave(data, bufferSize, aoChannels, dataAO);
+	    DAQmxErrChk(DAQmxBaseStopTask(taskHandleAO));
+	    DAQmxErrChk (DAQmxBaseWriteAnalogF64(taskHandleAO, samplesPerChanAO, 0, timeoutAO, DAQmx_Val_GroupByScanNumber, dataAO, &pointsWrittenAO, NULL));
+	    DAQmxErrChk (DAQmxBaseStartTask(taskHandleAO));
+	}
+
+	signal(SIGINT, my_handler);
+	DAQmxErrChk (DAQmxBaseIsTaskDone(taskHandleAO, &done));
+
+        readStart = Time::now();
+        DAQmxErrChk (DAQmxBaseReadAnalogF64(taskHandleAI, pointsToRead, timeout, DAQmx_Val_GroupByScanNumber, dataAI, aiChannels, &pointsRead, NULL));
+
+        //the AI task is untimed (on demand): the conversion happened somewhere
+        //inside the read call, its midpoint is the best estimate we have
+        nidaq::analogInput msg;
+	msg.header.stamp = readStart + Duration((Time::now() - readStart).toSec()*0.5);
+	msg.sample_index = totalRead;
+	msg.acquisition_time = msg.header.stamp;
+        totalRead += pointsRead;
+
+	nidaq::packScan(dataAI, &msg);
+
+	//wave_rate is dependent on a0;
+	//wave_rate = (dataAI[0]/MAXi) * common_rate;
+
+	//on-demand read: one scan per call
+	controlIn.block = dataAI;
+	controlIn.scans = 1;
+	controlIn.channels = aiChannels;
+	controlIn.scan = dataAI;
+	controlIn.time = msg.header.stamp.toSec();
+	controlIn.dt = lastStep > 0 ? controlIn.time - lastStep : 0;
+	lastStep = controlIn.time;
+	control.step(controlIn, data);
+
+	msg.publish_time = Time::now();
+	nidaq_pub.publish(msg);
+	spinOnce();
+
+	scheduler.wait();
+
+	if(nidaq::monotonicNs() - lastReport >= 1000000000LL){
+	    scheduler.printStats("loop");
+	    scheduler.resetStats();
+	    control.printStats("control");
+	    control.resetStats();
+	    lastReport = nidaq::monotonicNs();
+	}
+    }
+    
+Error:
+    if( DAQmxFailed(error) ){
+        DAQmxBaseGetExtendedErrorInfo(errBuff,2048);
+    }
+    if(taskHandleAI != 0) {
+        DAQmxBaseStopTask (taskHandleAO);
+        DAQmxBaseClearTask (taskHandleAO);
+        DAQmxBaseStopTask (taskHandleAI);
+        DAQmxBaseClearTask (taskHandleAI);
+    }
+    if( DAQmxFailed(error) )
+		printf ("DAQmxBase Error %ld: %s\n", error, errBuff);
+    return 0;
+}
@@ -32,87 +32,150 @@
 * Recommended Use:
 *    1. Call the Write function.
 *
+* ROS node:
+*    The task has no sample clock, so every write goes to the outputs
+*    at once (on-demand, software timed) and nothing runs between
+*    writes. Levels come in on VoltGen6221/setpoint (analogSetpoint);
+*    all channels of one setpoint are written with a single call and
+*    change together. A setpoint outside ~min..~max, or naming an
+*    unknown channel, is rejected whole. The levels held are latched
+*    on VoltGen6221/output after every write.
+*
+*        rosrun nidaq VoltGen6221 _channels:=Dev1/ao0:1 _initial:=5.0
+*        rostopic pub -1 /VoltGen6221/setpoint nidaq/analogSetpoint "{channels: [ao1], values: [2.5]}"
+*
 *********************************************************************/
 
 #include <NIDAQmxBase.h>
 #include <stdio.h>
 #include "ros/ros.h"
 #include "ros/console.h"
-#include "nidaq/analogOutput.h"
+#include "nidaq/analogSetpoint.h"
+#include "nidaq/channels.h"
 #include <signal.h>
 #include <stdlib.h>
+#include <vector>
 
 #define DAQmxErrChk(functionCall) { if( DAQmxFailed(error=(functionCall)) ) { goto Error; } }
 
 using namespace ros;
 
-static int gRunning = 0;
+static TaskHandle  taskHandle = 0;
+static std::vector<std::string> names;	//the task's channels, in order
+static std::vector<float64> levels;	//what the outputs hold now
+static float64     minV, maxV;
+static Publisher   output_pub;
+static nidaq::analogSetpoint output;
 
 void my_handler(int s){
     printf("Caught signal %d\n",s);
     exit(1); 
 }
 
+// index of "Dev1/ao1" or "ao1" in the task, -1 if not there
+static int findChannel(const std::string& name)
+{
+    for(size_t c = 0; c < names.size(); c++){
+        size_t slash = names[c].rfind('/');
+        if(name == names[c] || (slash != std::string::npos && name == names[c].substr(slash + 1)))
+            return c;
+    }
+    return -1;
+}
+
+// one scan, every channel: the outputs change together
+static int32 writeLevels(const std::vector<float64>& next)
+{
+    int32 pointsWritten;
+    int32 error = DAQmxBaseWriteAnalogF64(taskHandle, 1, 0, 1.0, DAQmx_Val_GroupByChannel, &next[0], &pointsWritten, NULL);
+    if(!DAQmxFailed(error)){
+        levels = next;
+        output.header.stamp = Time::now();
+        output.values = levels;
+        output_pub.publish(output);
+    }
+    return error;
+}
+
+static void setpointCallback(const nidaq::analogSetpoint::ConstPtr& msg)
+{
+    std::vector<float64> next = levels;
+
+    if(msg->channels.empty()){
+        if(msg->values.size() != levels.size()){
+            ROS_WARN("VoltGen6221: setpoint has %lu values for %lu channels, ignored", (unsigned long)msg->values.size(), (unsigned long)levels.size());
+            return;
+        }
+        next.assign(msg->values.begin(), msg->values.end());
+    }else{
+        if(msg->channels.size() != msg->values.size()){
+            ROS_WARN("VoltGen6221: setpoint names %lu channels for %lu values, ignored", (unsigned long)msg->channels.size(), (unsigned long)msg->values.size());
+            return;
+        }
+        for(size_t i = 0; i < msg->channels.size(); i++){
+            int c = findChannel(msg->channels[i]);
+            if(c < 0){
+                ROS_WARN("VoltGen6221: no channel %s, setpoint ignored", msg->channels[i].c_str());
+                return;
+            }
+            next[c] = msg->values[i];
+        }
+    }
+    for(size_t c = 0; c < next.size(); c++){
+        if(next[c] < minV || next[c] > maxV){
+            ROS_WARN("VoltGen6221: %.3f V for %s is outside %.1f..%.1f V, setpoint ignored", next[c], names[c].c_str(), minV, maxV);
+            return;
+        }
+    }
+
+    int32 error = writeLevels(next);
+    if(DAQmxFailed(error)){
+        char errBuff[2048]={'\0'};
+        DAQmxBaseGetExtendedErrorInfo(errBuff,2048);
+        ROS_ERROR("VoltGen6221: DAQmxBase Error %ld: %s", (long)error, errBuff);
+        return;
+    }
+    if(!msg->header.stamp.isZero())
+        ROS_DEBUG("VoltGen6221: setpoint out %.3f ms after its stamp", (output.header.stamp - msg->header.stamp).toSec()*1e3);
+}
+
 int main(int argc, char *argv[])
 {
-    const double common_sampling_rate = 2000.0;  //drastic freq change (/1000) -> Hz
-    
     init(argc, argv, "VoltGen6221");
 
     NodeHandle n;
+    NodeHandle pn("~");
 
-    Publisher nidaq_pub = n.advertise <nidaq::analogOutput> ("VoltGen6221", 0);
+    output_pub = n.advertise <nidaq::analogSetpoint> ("VoltGen6221/output", 1, true);
 
     // Task parameters
     int32       error = 0;
-    TaskHandle  taskHandle = 0;
     char        errBuff[2048]={'\0'};
-    bool32	done = 0;
 
     // Channel parameters
-    char        chan[] = "Dev1/ao1";
-    float64     min = 0.0;
-    float64     max = 5.0;
-
-    // Timing parameters
-    #define     bufferSize 1		//affects frequency
-    char	clockSource[] = "OnboardClock";
-    uInt64      samplesPerChan = bufferSize;
-    float64     sampleRate = common_sampling_rate;
-
-    // Data write parameters
-    float64     data = 5.0;
-    int32       pointsWritten;
-    float64     timeout = 10.0;
-    int32 	totalWritten = 0;
+    std::string chan;
+    double      initial;
+    pn.param("channels", chan, std::string("Dev1/ao1"));
+    pn.param("min", minV, 0.0);
+    pn.param("max", maxV, 5.0);
+    pn.param("initial", initial, 5.0);
+    if(!nidaq::expandChannels(chan, &names) || initial < minV || initial > maxV){
+        ROS_ERROR("VoltGen6221: bad ~channels, or ~initial outside ~min..~max");
+        return 1;
+    }
+    output.channels = names;
+    Subscriber setpoint_sub;
 
     ROS_INFO("NIDAQmx Base Voltage Generation started");
     DAQmxErrChk (DAQmxBaseCreateTask("",&taskHandle));
-    DAQmxErrChk (DAQmxBaseCreateAOVoltageChan(taskHandle,chan,clockSource,min,max,DAQmx_Val_Volts,NULL));
-    DAQmxErrChk (DAQmxBaseCfgSampClkTiming(taskHandle, clockSource, sampleRate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, samplesPerChan));
-
-    DAQmxErrChk (DAQmxBaseWriteAnalogF64(taskHandle,samplesPerChan,0,timeout,DAQmx_Val_GroupByChannel,&data,&pointsWritten,NULL));
-
+    DAQmxErrChk (DAQmxBaseCreateAOVoltageChan(taskHandle,chan.c_str(),"",minV,maxV,DAQmx_Val_Volts,NULL));
     DAQmxErrChk (DAQmxBaseStartTask(taskHandle));
+    DAQmxErrChk (writeLevels(std::vector<float64>(names.size(), initial)));
 
-    gRunning = 1;	
-    ROS_INFO("Loop will quit after pressing Ctrl+C");	    
-    while(gRunning && !done) {
-	signal(SIGINT, my_handler);
-
-        DAQmxErrChk (DAQmxBaseIsTaskDone(taskHandle, &done));
-	if( !done )
-            usleep(2000);	//500 Hz <-> 10^6/x Hz
-
-	nidaq::analogOutput msg;
-	msg.header.stamp = Time::now();
-
-	msg.o0 = data;
-	totalWritten += pointsWritten;	
-
-	nidaq_pub.publish(msg);
-	spinOnce();
-    }
+    setpoint_sub = n.subscribe("VoltGen6221/setpoint", 10, setpointCallback, TransportHints().tcpNoDelay());
+    signal(SIGINT, my_handler);
+    ROS_INFO("%s at %.3f V, waiting for setpoints", chan.c_str(), initial);
+    spin();
 
 Error:
     if( DAQmxFailed(error) )
@@ -0,0 +1,161 @@
+/*********************************************************************
+*    libnidaq_alloc_guard.so: malloc interposition behind
+*    nidaq/alloc_guard.h. Preload it; every allocation goes on to
+*    glibc's own entry points, and allocations made by a thread while
+*    it is armed are counted (NIDAQ_ALLOC_GUARD=report) or abort the
+*    process with a backtrace (NIDAQ_ALLOC_GUARD=abort). Inside an
+*    external section they are only counted, in a counter of their own.
+*
+*    The per-thread state is initial-exec TLS and a guarded allocation
+*    is reported with a stack buffer, write() and backtrace_symbols_fd(),
+*    so nothing here allocates by itself.
+*********************************************************************/
+
+#include <errno.h>
+#include <execinfo.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* p);
+}
+
+#define GUARD_OFF       0
+#define GUARD_REPORT    1
+#define GUARD_ABORT     2
+
+static int                      guardMode = -1;     // read from the environment on first use
+static std::atomic<uint64_t>    guardCount(0);
+static std::atomic<uint64_t>    externalCount(0);
+static __thread int             armed __attribute__((tls_model("initial-exec"))) = 0;
+static __thread int             external __attribute__((tls_model("initial-exec"))) = 0;
+
+static int mode()
+{
+    if(guardMode < 0){
+        const char *env = getenv("NIDAQ_ALLOC_GUARD");
+        if(env == NULL || strcmp(env, "0") == 0 || strcmp(env, "off") == 0)
+            guardMode = GUARD_OFF;
+        else if(strcmp(env, "abort") == 0)
+            guardMode = GUARD_ABORT;
+        else
+            guardMode = GUARD_REPORT;
+        if(guardMode == GUARD_ABORT){
+            void *frames[1];
+            backtrace(frames, 1);       // loads libgcc now, not inside a guarded section
+        }
+    }
+    return guardMode;
+}
+
+static void note(size_t size)
+{
+    if(armed <= 0)
+        return;
+    if(external > 0){
+        externalCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    guardCount.fetch_add(1, std::memory_order_relaxed);
+    if(guardMode != GUARD_ABORT)
+        return;
+
+    char line[128];
+    int n = snprintf(line, sizeof(line), "nidaq alloc guard: %lu-byte allocation in a guarded section\n", (unsigned long)size);
+    armed = 0;
+    if(write(STDERR_FILENO, line, n) < 0){}
+    void *frames[64];
+    backtrace_symbols_fd(frames, backtrace(frames, 64), STDERR_FILENO);
+    abort();
+}
+
+extern "C" {
+
+void nidaq_alloc_guard_arm(void)
+{
+    if(mode() != GUARD_OFF)
+        armed++;
+}
+
+void nidaq_alloc_guard_disarm(void)
+{
+    if(mode() != GUARD_OFF)
+        armed--;
+}
+
+void nidaq_alloc_guard_external_begin(void)
+{
+    external++;
+}
+
+void nidaq_alloc_guard_external_end(void)
+{
+    external--;
+}
+
+uint64_t nidaq_alloc_guard_count(void)
+{
+    return guardCount.load(std::memory_order_relaxed);
+}
+
+uint64_t nidaq_alloc_guard_external_count(void)
+{
+    return externalCount.load(std::memory_order_relaxed);
+}
+
+int nidaq_alloc_guard_mode(void)
+{
+    return mode();
+}
+
+void* malloc(size_t size)
+{
+    note(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    note(count*size);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, size_t size)
+{
+    note(size);
+    return __libc_realloc(p, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    note(size);
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    note(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** p, size_t alignment, size_t size)
+{
+    note(size);
+    *p = __libc_memalign(alignment, size);
+    return *p != NULL ? 0 : ENOMEM;
+}
+
+void free(void* p)
+{
+    __libc_free(p);
+}
+
+}
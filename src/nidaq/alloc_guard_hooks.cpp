@@ -0,0 +1,78 @@
+#include "nidaq/alloc_guard.h"
+
+#include <dlfcn.h>
+
+namespace nidaq {
+
+/*********************************************************************
+*    The entry points of libnidaq_alloc_guard.so, NULL when it is not
+*    preloaded. Looked up once, on the first call, which comes before
+*    the guard is armed; dlsym() may allocate.
+*********************************************************************/
+struct AllocGuardHooks {
+    void        (*arm)(void);
+    void        (*disarm)(void);
+    void        (*externalBegin)(void);
+    void        (*externalEnd)(void);
+    uint64_t    (*count)(void);
+    uint64_t    (*externalCount)(void);
+    int         (*mode)(void);      // 0 off, 1 report, 2 abort
+
+    AllocGuardHooks()
+    {
+        arm = (void (*)(void))dlsym(RTLD_DEFAULT, "nidaq_alloc_guard_arm");
+        disarm = (void (*)(void))dlsym(RTLD_DEFAULT, "nidaq_alloc_guard_disarm");
+        externalBegin = (void (*)(void))dlsym(RTLD_DEFAULT, "nidaq_alloc_guard_external_begin");
+        externalEnd = (void (*)(void))dlsym(RTLD_DEFAULT, "nidaq_alloc_guard_external_end");
+        count = (uint64_t (*)(void))dlsym(RTLD_DEFAULT, "nidaq_alloc_guard_count");
+        externalCount = (uint64_t (*)(void))dlsym(RTLD_DEFAULT, "nidaq_alloc_guard_external_count");
+        mode = (int (*)(void))dlsym(RTLD_DEFAULT, "nidaq_alloc_guard_mode");
+    }
+};
+
+static const AllocGuardHooks& hooks()
+{
+    static const AllocGuardHooks h;
+    return h;
+}
+
+bool allocGuardActive()
+{
+    return hooks().mode != NULL && hooks().mode() != 0;
+}
+
+void allocGuardArm()
+{
+    if(hooks().arm != NULL)
+        hooks().arm();
+}
+
+void allocGuardDisarm()
+{
+    if(hooks().disarm != NULL)
+        hooks().disarm();
+}
+
+uint64_t allocGuardCount()
+{
+    return hooks().count != NULL ? hooks().count() : 0;
+}
+
+uint64_t allocGuardExternalCount()
+{
+    return hooks().externalCount != NULL ? hooks().externalCount() : 0;
+}
+
+AllocGuardExternal::AllocGuardExternal()
+{
+    if(hooks().externalBegin != NULL)
+        hooks().externalBegin();
+}
+
+AllocGuardExternal::~AllocGuardExternal()
+{
+    if(hooks().externalEnd != NULL)
+        hooks().externalEnd();
+}
+
+}
@@ -0,0 +1,144 @@
+#include "nidaq/channel_filter.h"
+
+#include <math.h>
+#include <unistd.h>
+
+#define MAX_SECTIONS 8
+
+namespace nidaq {
+
+bool designBiquad(const std::string& type, double cutoff, double q, double rate, Biquad* out)
+{
+    if(cutoff <= 0 || cutoff >= rate/2 || q <= 0)
+        return false;
+
+    double w0 = 2*M_PI*cutoff/rate;
+    double cw = cos(w0);
+    double alpha = sin(w0)/(2*q);
+    double a0 = 1 + alpha;
+
+    if(type == "lowpass"){
+        out->b0 = (1 - cw)/2;
+        out->b1 = 1 - cw;
+        out->b2 = (1 - cw)/2;
+    }else if(type == "highpass"){
+        out->b0 = (1 + cw)/2;
+        out->b1 = -(1 + cw);
+        out->b2 = (1 + cw)/2;
+    }else if(type == "bandpass"){
+        out->b0 = alpha;        // 0 dB peak gain
+        out->b1 = 0;
+        out->b2 = -alpha;
+    }else{
+        return false;
+    }
+    out->b0 /= a0;
+    out->b1 /= a0;
+    out->b2 /= a0;
+    out->a1 = -2*cw/a0;
+    out->a2 = (1 - alpha)/a0;
+    return true;
+}
+
+void loadFilterConfig(const ros::NodeHandle& nh, FilterConfig* config)
+{
+    nh.param("process/filter", config->type, std::string("none"));
+    nh.param("process/cutoff", config->cutoff, 100.0);
+    nh.param("process/q", config->q, 0.7071);
+    nh.param("process/sections", config->sections, 1);
+    nh.param("process/threads", config->threads, 0);
+    nh.param("process/channels_per_task", config->channelsPerTask, 1);
+}
+
+ChannelFilter::ChannelFilter()
+    : pool_(NULL), sections_(0), channels_(0), perTask_(1), in_(NULL), scans_(0), out_(NULL)
+{
+}
+
+ChannelFilter::~ChannelFilter()
+{
+    delete pool_;
+}
+
+bool ChannelFilter::configure(const FilterConfig& config, uint32_t channels, double rate)
+{
+    delete pool_;
+    pool_ = NULL;
+    if(config.type == "none" || config.type.empty())
+        return true;
+    if(!designBiquad(config.type, config.cutoff, config.q, rate, &coeffs_)){
+        ROS_ERROR("process: cannot design a %s filter at %.1f Hz (q %.3f) for %.0f S/s", config.type.c_str(), config.cutoff, config.q, rate);
+        return false;
+    }
+
+    sections_ = config.sections > 0 ? config.sections : 1;
+    if(sections_ > MAX_SECTIONS)
+        sections_ = MAX_SECTIONS;
+    channels_ = channels;
+    perTask_ = config.channelsPerTask > 0 ? config.channelsPerTask : 1;
+    state_.assign(channels_*sections_*2, 0.0);
+
+    // more threads than tasks would only wait
+    int tasks = (channels_ + perTask_ - 1)/perTask_;
+    int threads = config.threads > 0 ? config.threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads > tasks)
+        threads = tasks;
+    pool_ = new ThreadPool(threads);
+    ROS_INFO("process: %s %.1f Hz, %d sections on %u channels, %d tasks on %d threads",
+        config.type.c_str(), config.cutoff, sections_, channels_, tasks, pool_->threads());
+    return true;
+}
+
+void ChannelFilter::reset()
+{
+    state_.assign(state_.size(), 0.0);
+}
+
+void ChannelFilter::process(const double* scanMajor, uint32_t scans, float* channelMajor)
+{
+    in_ = scanMajor;
+    scans_ = scans;
+    out_ = channelMajor;
+    pool_->run(task, this, (channels_ + perTask_ - 1)/perTask_);
+}
+
+void ChannelFilter::task(void* ctx, size_t index)
+{
+    ChannelFilter *self = (ChannelFilter *)ctx;
+    uint32_t first = index*self->perTask_;
+    uint32_t last = first + self->perTask_ < self->channels_ ? first + self->perTask_ : self->channels_;
+
+    for(uint32_t c = first; c < last; c++)
+        self->filterChannel(c);
+}
+
+void ChannelFilter::filterChannel(uint32_t channel)
+{
+    const Biquad& f = coeffs_;
+    const double *in = in_ + channel;
+    float *out = out_ + (size_t)channel*scans_;
+    double *state = &state_[channel*sections_*2];
+    double z[2*MAX_SECTIONS];
+
+    // the state lives on this thread's stack while it runs: neighbouring
+    // channels' state shares cache lines and belongs to other threads
+    for(int k = 0; k < 2*sections_; k++)
+        z[k] = state[k];
+
+    // transposed direct form II, all sections per sample in double
+    for(uint32_t s = 0; s < scans_; s++){
+        double x = in[(size_t)s*channels_];
+        for(int k = 0; k < sections_; k++){
+            double y = f.b0*x + z[2*k];
+            z[2*k] = f.b1*x - f.a1*y + z[2*k + 1];
+            z[2*k + 1] = f.b2*x - f.a2*y;
+            x = y;
+        }
+        out[s] = (float)x;
+    }
+
+    for(int k = 0; k < 2*sections_; k++)
+        state[k] = z[k];
+}
+
+}
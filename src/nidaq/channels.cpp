@@ -0,0 +1,128 @@
+#include "nidaq/channels.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace nidaq {
+
+int countChannels(const std::string& list)
+{
+    int count = 0;
+    size_t start = 0;
+
+    while(start < list.size()){
+        size_t end = list.find(',', start);
+        if(end == std::string::npos)
+            end = list.size();
+        std::string entry = list.substr(start, end - start);
+        start = end + 1;
+
+        size_t colon = entry.find(':');
+        if(colon == std::string::npos){
+            if(!entry.empty())
+                count++;
+            continue;
+        }
+
+        // first number is the run of digits right before the colon
+        size_t digits = colon;
+        while(digits > 0 && entry[digits - 1] >= '0' && entry[digits - 1] <= '9')
+            digits--;
+        if(digits == colon)
+            return 0;
+        int first = atoi(entry.c_str() + digits);
+        int last = atoi(entry.c_str() + colon + 1);
+        count += (last >= first ? last - first : first - last) + 1;
+    }
+    return count;
+}
+
+bool expandChannels(const std::string& list, std::vector<std::string>* names)
+{
+    size_t start = 0;
+
+    names->clear();
+    while(start < list.size()){
+        size_t end = list.find(',', start);
+        if(end == std::string::npos)
+            end = list.size();
+        std::string entry = list.substr(start, end - start);
+        start = end + 1;
+
+        size_t colon = entry.find(':');
+        if(colon == std::string::npos){
+            if(!entry.empty())
+                names->push_back(entry);
+            continue;
+        }
+
+        size_t digits = colon;
+        while(digits > 0 && entry[digits - 1] >= '0' && entry[digits - 1] <= '9')
+            digits--;
+        if(digits == colon){
+            names->clear();
+            return false;
+        }
+        std::string prefix = entry.substr(0, digits);
+        int first = atoi(entry.c_str() + digits);
+        int last = atoi(entry.c_str() + colon + 1);
+        int step = last >= first ? 1 : -1;
+        for(int c = first; ; c += step){
+            char number[16];
+            snprintf(number, sizeof(number), "%d", c);
+            names->push_back(prefix + number);
+            if(c == last)
+                break;
+        }
+    }
+    return !names->empty();
+}
+
+static bool parseIndex(const std::string& text, int* value)
+{
+    size_t i = 0;
+    if(text.compare(0, 2, "ai") == 0)
+        i = 2;
+    if(i >= text.size())
+        return false;
+    for(size_t k = i; k < text.size(); k++)
+        if(text[k] < '0' || text[k] > '9')
+            return false;
+    *value = atoi(text.c_str() + i);
+    return true;
+}
+
+bool parseChannelIndices(const std::string& list, int channels, std::vector<int>* indices)
+{
+    size_t start = 0;
+
+    indices->clear();
+    while(start < list.size()){
+        size_t end = list.find(',', start);
+        if(end == std::string::npos)
+            end = list.size();
+        std::string entry = list.substr(start, end - start);
+        start = end + 1;
+
+        int first, last;
+        size_t colon = entry.find(':');
+        if(colon == std::string::npos){
+            if(!parseIndex(entry, &first))
+                return false;
+            last = first;
+        }else if(!parseIndex(entry.substr(0, colon), &first) || !parseIndex(entry.substr(colon + 1), &last)){
+            return false;
+        }
+        int step = last >= first ? 1 : -1;
+        for(int c = first; ; c += step){
+            if(c >= channels)
+                return false;
+            indices->push_back(c);
+            if(c == last)
+                break;
+        }
+    }
+    return !indices->empty();
+}
+
+}
@@ -0,0 +1,74 @@
+#include "nidaq/contact_detector.h"
+
+#include "ros/ros.h"
+
+namespace nidaq {
+
+ContactDetector::ContactDetector()
+    : on_(0), off_(0), debounce_(1)
+{
+}
+
+bool ContactDetector::configure(uint32_t channels, double on, double off, uint32_t debounce)
+{
+    if(channels == 0 || off >= on){
+        ROS_ERROR("contact detector: needs channels and an off threshold below the on threshold (%.3f, %.3f)", off, on);
+        return false;
+    }
+    on_ = on;
+    off_ = off;
+    debounce_ = debounce > 0 ? debounce : 1;
+    channels_.resize(channels);
+    reset();
+    return true;
+}
+
+void ContactDetector::reset()
+{
+    for(size_t c = 0; c < channels_.size(); c++){
+        channels_[c].contact = false;
+        channels_[c].run = 0;
+        channels_[c].runStart = 0;
+        channels_[c].runForce = 0;
+    }
+}
+
+void ContactDetector::restartRuns()
+{
+    for(size_t c = 0; c < channels_.size(); c++)
+        channels_[c].run = 0;
+}
+
+void ContactDetector::process(const double* block, uint32_t scans, uint64_t first, std::vector<ContactChange>* changes)
+{
+    uint32_t n = (uint32_t)channels_.size();
+
+    for(uint32_t s = 0; s < scans; s++){
+        const double *scan = block + (size_t)s*n;
+        for(uint32_t c = 0; c < n; c++){
+            Channel& ch = channels_[c];
+            bool other = ch.contact ? scan[c] <= off_ : scan[c] >= on_;
+            if(!other){
+                ch.run = 0;
+                continue;
+            }
+            if(ch.run++ == 0){
+                ch.runStart = first + s;
+                ch.runForce = (float)scan[c];
+            }
+            if(ch.run < debounce_)
+                continue;
+
+            ch.contact = !ch.contact;
+            ch.run = 0;
+            ContactChange change;
+            change.channel = c;
+            change.contact = ch.contact;
+            change.sample = ch.runStart;
+            change.force = ch.runForce;
+            changes->push_back(change);
+        }
+    }
+}
+
+}
@@ -0,0 +1,347 @@
+#include "nidaq/control_law.h"
+#include "nidaq/kernels.h"
+#include "nidaq/loop_scheduler.h"
+
+#include <dlfcn.h>
+#include <map>
+#include <vector>
+
+namespace nidaq {
+
+/*********************************************************************
+*    Built-in laws
+*********************************************************************/
+
+// ~law/channel, which must be one of the aiChannels of ControlInput::scan
+static bool loadChannel(const ros::NodeHandle& nh, uint32_t aiChannels, int* channel)
+{
+    nh.param("law/channel", *channel, 0);
+    if(*channel < 0 || (uint32_t)*channel >= aiChannels){
+        ROS_ERROR("control law: ~law/channel %d is not one of the %u AI channels", *channel, aiChannels);
+        return false;
+    }
+    return true;
+}
+
+// 2.5*((ai0-MIN)/(MAX-MIN))*sin(), MIN/MAX being the range of ai0 seen so far
+class AmplitudeLaw : public ControlLaw {
+public:
+    bool configure(const ros::NodeHandle& nh, uint32_t aoSamples, uint32_t aiChannels)
+    {
+        if(!loadChannel(nh, aiChannels, &channel_))
+            return false;
+        nh.param("law/amplitude", amplitude_, 2.5);
+        unitSine_.resize(aoSamples);
+        fillSine(&unitSine_[0], aoSamples, 1.0);
+        reset();
+        return true;
+    }
+
+    void reset()
+    {
+        min_ = 10;
+        max_ = 0;
+    }
+
+    void update(const ControlInput& in, double* ao, uint32_t aoSamples)
+    {
+        double v = in.scan[channel_];
+        if(v > max_)
+            max_ = v;
+        if(v < min_)
+            min_ = v;
+        amplitudeLaw(&unitSine_[0], aoSamples, v, min_, max_, amplitude_, ao);
+    }
+
+private:
+    int                 channel_;
+    double              amplitude_;
+    double              min_, max_;
+    std::vector<double> unitSine_;
+};
+
+// DC level gain*ai + offset
+class GainLaw : public ControlLaw {
+public:
+    bool configure(const ros::NodeHandle& nh, uint32_t aoSamples, uint32_t aiChannels)
+    {
+        if(!loadChannel(nh, aiChannels, &channel_))
+            return false;
+        nh.param("law/gain", gain_, 1.0);
+        nh.param("law/offset", offset_, 0.0);
+        return true;
+    }
+
+    void update(const ControlInput& in, double* ao, uint32_t aoSamples)
+    {
+        double level = gain_*in.scan[channel_] + offset_;
+        for(uint32_t i = 0; i < aoSamples; i++)
+            ao[i] = level;
+    }
+
+private:
+    int     channel_;
+    double  gain_, offset_;
+};
+
+// DC level from a PID on ai, derivative on the measurement, integral clamped to the output range
+class PidLaw : public ControlLaw {
+public:
+    bool configure(const ros::NodeHandle& nh, uint32_t aoSamples, uint32_t aiChannels)
+    {
+        if(!loadChannel(nh, aiChannels, &channel_))
+            return false;
+        nh.param("law/setpoint", setpoint_, 0.0);
+        nh.param("law/kp", kp_, 1.0);
+        nh.param("law/ki", ki_, 0.0);
+        nh.param("law/kd", kd_, 0.0);
+        nh.param("law/out_min", outMin_, -5.0);
+        nh.param("law/out_max", outMax_, 5.0);
+        reset();
+        return true;
+    }
+
+    void reset()
+    {
+        integral_ = 0;
+        last_ = 0;
+        first_ = true;
+    }
+
+    void update(const ControlInput& in, double* ao, uint32_t aoSamples)
+    {
+        double v = in.scan[channel_];
+        double err = setpoint_ - v;
+        double deriv = 0;
+        if(!first_ && in.dt > 0){
+            integral_ += ki_*err*in.dt;
+            deriv = -(v - last_)/in.dt;
+        }
+        if(integral_ > outMax_)
+            integral_ = outMax_;
+        if(integral_ < outMin_)
+            integral_ = outMin_;
+        last_ = v;
+        first_ = false;
+
+        double level = kp_*err + integral_ + kd_*deriv;
+        for(uint32_t i = 0; i < aoSamples; i++)
+            ao[i] = level;
+    }
+
+private:
+    int     channel_;
+    double  setpoint_, kp_, ki_, kd_, outMin_, outMax_;
+    double  integral_, last_;
+    bool    first_;
+};
+
+// DC level from a piecewise linear table law/lut_x -> law/lut_y, held flat past the ends
+class LutLaw : public ControlLaw {
+public:
+    bool configure(const ros::NodeHandle& nh, uint32_t aoSamples, uint32_t aiChannels)
+    {
+        if(!loadChannel(nh, aiChannels, &channel_))
+            return false;
+        if(!nh.getParam("law/lut_x", x_) || !nh.getParam("law/lut_y", y_) ||
+           x_.size() != y_.size() || x_.empty()){
+            ROS_ERROR("control law lut: needs ~law/lut_x and ~law/lut_y of the same, non-zero length");
+            return false;
+        }
+        for(size_t i = 1; i < x_.size(); i++){
+            if(x_[i] <= x_[i - 1]){
+                ROS_ERROR("control law lut: ~law/lut_x must be strictly increasing");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void update(const ControlInput& in, double* ao, uint32_t aoSamples)
+    {
+        double v = in.scan[channel_];
+        size_t n = x_.size();
+        double level;
+        if(v <= x_[0]){
+            level = y_[0];
+        }else if(v >= x_[n - 1]){
+            level = y_[n - 1];
+        }else{
+            size_t hi = 1;
+            while(x_[hi] < v)
+                hi++;
+            double f = (v - x_[hi - 1])/(x_[hi] - x_[hi - 1]);
+            level = y_[hi - 1] + f*(y_[hi] - y_[hi - 1]);
+        }
+        for(uint32_t i = 0; i < aoSamples; i++)
+            ao[i] = level;
+    }
+
+private:
+    int                 channel_;
+    std::vector<double> x_, y_;
+};
+
+// sine of amplitude law/amplitude at f0 + kf*ai Hz, phase continuous from buffer to buffer
+class FrequencyLaw : public ControlLaw {
+public:
+    bool configure(const ros::NodeHandle& nh, uint32_t aoSamples, uint32_t aiChannels)
+    {
+        if(!loadChannel(nh, aiChannels, &channel_))
+            return false;
+        nh.param("law/amplitude", amplitude_, 2.5);
+        nh.param("law/f0", f0_, 10.0);
+        nh.param("law/kf", kf_, 1.0);
+        nh.param("law/ao_rate", aoRate_, 5000.0);
+        reset();
+        return aoRate_ > 0;
+    }
+
+    void reset()
+    {
+        phase_ = 0;
+    }
+
+    void update(const ControlInput& in, double* ao, uint32_t aoSamples)
+    {
+        double step = 2.0*NIDAQ_PI*(f0_ + kf_*in.scan[channel_])/aoRate_;
+        for(uint32_t i = 0; i < aoSamples; i++){
+            ao[i] = amplitude_*sin(phase_);
+            phase_ += step;
+        }
+        phase_ = fmod(phase_, 2.0*NIDAQ_PI);
+    }
+
+private:
+    int     channel_;
+    double  amplitude_, f0_, kf_, aoRate_;
+    double  phase_;
+};
+
+template <typename Law>
+static ControlLaw* makeLaw()
+{
+    return new Law();
+}
+
+/*********************************************************************
+*    Registry
+*********************************************************************/
+static std::map<std::string, ControlLawFactory>& registry()
+{
+    static std::map<std::string, ControlLawFactory> laws;
+    if(laws.empty()){
+        laws["amplitude"] = makeLaw<AmplitudeLaw>;
+        laws["gain"] = makeLaw<GainLaw>;
+        laws["pid"] = makeLaw<PidLaw>;
+        laws["lut"] = makeLaw<LutLaw>;
+        laws["frequency"] = makeLaw<FrequencyLaw>;
+    }
+    return laws;
+}
+
+void registerControlLaw(const std::string& name, ControlLawFactory factory)
+{
+    registry()[name] = factory;
+}
+
+ControlLaw* createControlLaw(const std::string& name)
+{
+    std::map<std::string, ControlLawFactory>::const_iterator it = registry().find(name);
+    if(it != registry().end())
+        return it->second();
+
+    if(name.find(".so") == std::string::npos){
+        ROS_ERROR("Unknown control law '%s'", name.c_str());
+        return NULL;
+    }
+    // plug-ins stay loaded for the life of the process
+    void *lib = dlopen(name.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if(lib == NULL){
+        ROS_ERROR("Cannot load control law %s: %s", name.c_str(), dlerror());
+        return NULL;
+    }
+    ControlLawFactory factory = (ControlLawFactory)dlsym(lib, "nidaq_create_control_law");
+    if(factory == NULL){
+        ROS_ERROR("%s does not export nidaq_create_control_law (NIDAQ_EXPORT_CONTROL_LAW)", name.c_str());
+        dlclose(lib);
+        return NULL;
+    }
+    registry()[name] = factory;
+    return factory();
+}
+
+/*********************************************************************
+*    Loop
+*********************************************************************/
+ControlLoop::ControlLoop()
+    : law_(NULL), aoSamples_(0), budgetUs_(0), min_(-5), max_(5)
+{
+    resetStats();
+}
+
+ControlLoop::~ControlLoop()
+{
+    delete law_;
+}
+
+bool ControlLoop::configure(const ros::NodeHandle& nh, uint32_t aoSamples, uint32_t aiChannels)
+{
+    nh.param("control_law", name_, std::string("amplitude"));
+    nh.param("control_budget_us", budgetUs_, 0.0);
+    nh.param("control_min", min_, -5.0);
+    nh.param("control_max", max_, 5.0);
+
+    delete law_;
+    law_ = createControlLaw(name_);
+    if(law_ == NULL)
+        return false;
+    if(!law_->configure(nh, aoSamples, aiChannels)){
+        ROS_ERROR("Control law '%s' rejected its parameters", name_.c_str());
+        delete law_;
+        law_ = NULL;
+        return false;
+    }
+    aoSamples_ = aoSamples;
+    ROS_INFO("Control law '%s', budget %.1f us per scan", name_.c_str(), budgetUs_);
+    return true;
+}
+
+bool ControlLoop::step(const ControlInput& in, double* ao)
+{
+    int64_t start = monotonicNs();
+    law_->update(in, ao, aoSamples_);
+    for(uint32_t i = 0; i < aoSamples_; i++){
+        if(ao[i] > max_)
+            ao[i] = max_;
+        else if(ao[i] < min_)
+            ao[i] = min_;
+    }
+    double us = (monotonicNs() - start)*1e-3;
+
+    stats_.steps++;
+    jitterAdd(&stats_.latency, us);
+    if(budgetUs_ > 0 && us > budgetUs_*(in.scans > 0 ? in.scans : 1)){
+        stats_.overBudget++;
+        return false;
+    }
+    return true;
+}
+
+void ControlLoop::resetStats()
+{
+    stats_.steps = 0;
+    stats_.overBudget = 0;
+    jitterReset(&stats_.latency);
+}
+
+void ControlLoop::printStats(const char* label) const
+{
+    const JitterStats& l = stats_.latency;
+    if(stats_.steps == 0)
+        return;
+    ROS_INFO("%s: law '%s', %llu steps, %llu over budget, %.1f/%.1f/%.1f us min/mean/max", label, name_.c_str(),
+        (unsigned long long)stats_.steps, (unsigned long long)stats_.overBudget, l.min, l.sum/l.count, l.max);
+}
+
+}
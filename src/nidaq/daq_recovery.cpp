@@ -0,0 +1,121 @@
+#include "nidaq/daq_recovery.h"
+#include "nidaq/loop_scheduler.h"
+
+#include "ros/ros.h"
+
+// NI-DAQmx status codes, DAQmx Base reports the same values
+#define ErrorSamplesNoLongerAvailable           -200279    // AI buffer overwritten before it was read
+#define ErrorInputFIFOOverflow                  -200010
+#define ErrorOnboardMemOverflow                 -200361
+#define ErrorGenStoppedToPreventRegen           -200290    // AO ran out of new samples
+#define ErrorOutputFIFOUnderflow                -200016
+#define ErrorOutputFIFOUnderflow2               -200018
+#define ErrorOnboardMemUnderflow                -200621
+#define ErrorSamplesNotYetAvailable             -200284    // read timed out
+#define ErrorSamplesCanNotYetBeWritten          -200292    // write timed out
+
+namespace nidaq {
+
+DaqErrorClass classifyDaqError(int32 error)
+{
+    switch(error){
+    case 0:
+        return DAQ_OK;
+    case ErrorSamplesNoLongerAvailable:
+    case ErrorInputFIFOOverflow:
+    case ErrorOnboardMemOverflow:
+        return DAQ_OVERRUN;
+    case ErrorGenStoppedToPreventRegen:
+    case ErrorOutputFIFOUnderflow:
+    case ErrorOutputFIFOUnderflow2:
+    case ErrorOnboardMemUnderflow:
+        return DAQ_UNDERRUN;
+    case ErrorSamplesNotYetAvailable:
+    case ErrorSamplesCanNotYetBeWritten:
+        return DAQ_TIMEOUT;
+    default:
+        return error > 0 ? DAQ_OK : DAQ_FATAL;	//positive values are warnings
+    }
+}
+
+const char* daqErrorClassName(DaqErrorClass cls)
+{
+    switch(cls){
+    case DAQ_OK:        return "ok";
+    case DAQ_OVERRUN:   return "overrun";
+    case DAQ_UNDERRUN:  return "underrun";
+    case DAQ_TIMEOUT:   return "timeout";
+    default:            return "fatal";
+    }
+}
+
+void resetRecoveryStats(RecoveryStats* stats)
+{
+    stats->overruns = 0;
+    stats->underruns = 0;
+    stats->timeouts = 0;
+    stats->restarts = 0;
+    stats->gapSamples = 0;
+    stats->lastRecoverMs = 0;
+    stats->maxRecoverMs = 0;
+}
+
+bool recoverTask(TaskHandle task, int32 error, RecoveryStats* stats)
+{
+    DaqErrorClass cls = classifyDaqError(error);
+
+    switch(cls){
+    case DAQ_OK:
+        return true;
+    case DAQ_TIMEOUT:
+        stats->timeouts++;
+        return true;
+    case DAQ_OVERRUN:
+        stats->overruns++;
+        break;
+    case DAQ_UNDERRUN:
+        stats->underruns++;
+        break;
+    default:
+        return false;
+    }
+
+    int64_t start = monotonicNs();
+    DAQmxBaseStopTask(task);
+    int32 restart = DAQmxBaseStartTask(task);
+    double ms = (monotonicNs() - start) / 1e6;
+
+    stats->restarts++;
+    stats->lastRecoverMs = ms;
+    if(ms > stats->maxRecoverMs)
+        stats->maxRecoverMs = ms;
+    ROS_WARN("DAQmx %s (error %ld), task restarted in %.2f ms", daqErrorClassName(cls), (long)error, ms);
+    return !DAQmxFailed(restart);
+}
+
+bool disableRegeneration(TaskHandle task)
+{
+#ifdef DAQmx_Write_RegenMode
+    int32 error = DAQmxBaseSetWriteAttribute(task, DAQmx_Write_RegenMode, DAQmx_Val_DoNotAllowRegen);
+    if(!DAQmxFailed(error))
+        return true;
+    ROS_ERROR("Cannot turn AO regeneration off (error %ld), refusing to stream", (long)error);
+#else
+    ROS_ERROR("This NI-DAQmx Base has no DAQmx_Write_RegenMode: a streamed AO task would replay stale samples, refusing to stream");
+#endif
+    return false;
+}
+
+void fillDiagnostics(const RecoveryStats& stats, daqDiagnostics* msg)
+{
+    msg->header.stamp = ros::Time::now();
+    msg->overruns = stats.overruns;
+    msg->underruns = stats.underruns;
+    msg->timeouts = stats.timeouts;
+    msg->restarts = stats.restarts;
+    msg->gap_samples = stats.gapSamples;
+    msg->last_recover_ms = stats.lastRecoverMs;
+    msg->max_recover_ms = stats.maxRecoverMs;
+}
+
+}
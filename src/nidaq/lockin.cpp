@@ -0,0 +1,235 @@
+#include "nidaq/lockin.h"
+#include "nidaq/kernels.h"
+
+#include "ros/ros.h"
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NIDAQ_X86 1
+#include <immintrin.h>
+#endif
+
+#define MAX_ORDER 4
+
+namespace nidaq {
+
+/*********************************************************************
+*    Mix-and-filter kernels. For scans s of the block, channels
+*    [c0, c1): u = x*ref, v = x*quad, then every stage j
+*        state[j][0][c] += alpha*(u - state[j][0][c]), u = that
+*    and the same for v in state[j][1][c].
+*********************************************************************/
+struct MixBlock {
+    const double*   in;
+    uint32_t        scans;
+    uint32_t        channels;
+    const double*   ref;
+    const double*   quad;
+    uint32_t        length;
+    uint32_t        phase;          // table index of the first scan
+    double          alpha;
+    int             order;
+    double*         state;
+};
+
+static void mixScalar(const MixBlock& b, uint32_t c0)
+{
+    uint32_t k = b.phase;
+    for(uint32_t s = 0; s < b.scans; s++){
+        const double *row = b.in + (size_t)s*b.channels;
+        for(uint32_t c = c0; c < b.channels; c++){
+            double u = row[c]*b.ref[k];
+            double v = row[c]*b.quad[k];
+            for(int j = 0; j < b.order; j++){
+                double *x = b.state + (size_t)2*j*b.channels;
+                double *y = x + b.channels;
+                x[c] += b.alpha*(u - x[c]);
+                y[c] += b.alpha*(v - y[c]);
+                u = x[c];
+                v = y[c];
+            }
+        }
+        if(++k == b.length)
+            k = 0;
+    }
+}
+
+#ifdef NIDAQ_X86
+static void mixSse2(const MixBlock& b)
+{
+    uint32_t c2 = b.channels & ~1u;
+    __m128d a = _mm_set1_pd(b.alpha);
+    uint32_t k = b.phase;
+    for(uint32_t s = 0; s < b.scans; s++){
+        const double *row = b.in + (size_t)s*b.channels;
+        __m128d r = _mm_set1_pd(b.ref[k]);
+        __m128d q = _mm_set1_pd(b.quad[k]);
+        for(uint32_t c = 0; c < c2; c += 2){
+            __m128d in = _mm_loadu_pd(row + c);
+            __m128d u = _mm_mul_pd(in, r);
+            __m128d v = _mm_mul_pd(in, q);
+            for(int j = 0; j < b.order; j++){
+                double *x = b.state + (size_t)2*j*b.channels + c;
+                double *y = x + b.channels;
+                __m128d xs = _mm_loadu_pd(x);
+                __m128d ys = _mm_loadu_pd(y);
+                xs = _mm_add_pd(xs, _mm_mul_pd(a, _mm_sub_pd(u, xs)));
+                ys = _mm_add_pd(ys, _mm_mul_pd(a, _mm_sub_pd(v, ys)));
+                _mm_storeu_pd(x, xs);
+                _mm_storeu_pd(y, ys);
+                u = xs;
+                v = ys;
+            }
+        }
+        if(++k == b.length)
+            k = 0;
+    }
+    mixScalar(b, c2);
+}
+
+#define NIDAQ_AVX2 __attribute__((target("avx2")))
+
+NIDAQ_AVX2 static void mixAvx2(const MixBlock& b)
+{
+    uint32_t c4 = b.channels & ~3u;
+    __m256d a = _mm256_set1_pd(b.alpha);
+    uint32_t k = b.phase;
+    for(uint32_t s = 0; s < b.scans; s++){
+        const double *row = b.in + (size_t)s*b.channels;
+        __m256d r = _mm256_set1_pd(b.ref[k]);
+        __m256d q = _mm256_set1_pd(b.quad[k]);
+        for(uint32_t c = 0; c < c4; c += 4){
+            __m256d in = _mm256_loadu_pd(row + c);
+            __m256d u = _mm256_mul_pd(in, r);
+            __m256d v = _mm256_mul_pd(in, q);
+            for(int j = 0; j < b.order; j++){
+                double *x = b.state + (size_t)2*j*b.channels + c;
+                double *y = x + b.channels;
+                __m256d xs = _mm256_loadu_pd(x);
+                __m256d ys = _mm256_loadu_pd(y);
+                xs = _mm256_add_pd(xs, _mm256_mul_pd(a, _mm256_sub_pd(u, xs)));
+                ys = _mm256_add_pd(ys, _mm256_mul_pd(a, _mm256_sub_pd(v, ys)));
+                _mm256_storeu_pd(x, xs);
+                _mm256_storeu_pd(y, ys);
+                u = xs;
+                v = ys;
+            }
+        }
+        if(++k == b.length)
+            k = 0;
+    }
+    mixScalar(b, c4);
+}
+#endif
+
+static void mixScalarAll(const MixBlock& b)
+{
+    mixScalar(b, 0);
+}
+
+typedef void (*MixKernel)(const MixBlock&);
+
+static MixKernel pickKernel()
+{
+#ifdef NIDAQ_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return mixAvx2;
+    if(__builtin_cpu_supports("sse2"))
+        return mixSse2;
+#endif
+    return mixScalarAll;
+}
+
+static MixKernel kernel()
+{
+    static const MixKernel k = pickKernel();
+    return k;
+}
+
+/*********************************************************************
+*    LockIn
+*********************************************************************/
+LockIn::LockIn()
+    : channels_(0), length_(0), order_(0), alpha_(0), tau_(0), frequency_(0)
+{
+}
+
+bool LockIn::configure(const WaveformSpec& excitation, uint32_t length, uint32_t channels,
+                       double rate, double tau, int order)
+{
+    if(excitation.shape == WaveformSpec::DC || length == 0 || channels == 0){
+        ROS_ERROR("lockin: the excitation must be a sine or cosine with a non-empty buffer");
+        return false;
+    }
+    if(rate <= 0 || tau <= 0 || order < 1 || order > MAX_ORDER){
+        ROS_ERROR("lockin: bad time constant %g s or order %d (1..%d)", tau, order, MAX_ORDER);
+        return false;
+    }
+
+    // the same phases fillWaveform() gave the AO buffer, at unit amplitude
+    WaveformSpec ref = excitation;
+    ref.shape = WaveformSpec::SINE;
+    ref.amplitude = 1.0;
+    if(excitation.shape == WaveformSpec::COSINE)
+        ref.phase += NIDAQ_PI/2;
+    inPhase_.resize(length);
+    fillWaveform(ref, &inPhase_[0], length);
+    ref.phase += NIDAQ_PI/2;
+    quadrature_.resize(length);
+    fillWaveform(ref, &quadrature_[0], length);
+
+    channels_ = channels;
+    length_ = length;
+    order_ = order;
+    tau_ = tau;
+    alpha_ = 1.0 - exp(-1.0/(rate*tau));
+    frequency_ = rate*excitation.cycles/length;
+    state_.assign((size_t)2*order_*channels_, 0.0);
+    return true;
+}
+
+void LockIn::reset()
+{
+    state_.assign(state_.size(), 0.0);
+}
+
+void LockIn::process(const double* scanMajor, uint32_t scans, uint64_t position)
+{
+    MixBlock b;
+    b.in = scanMajor;
+    b.scans = scans;
+    b.channels = channels_;
+    b.ref = &inPhase_[0];
+    b.quad = &quadrature_[0];
+    b.length = length_;
+    b.phase = (uint32_t)(position % length_);
+    b.alpha = alpha_;
+    b.order = order_;
+    b.state = &state_[0];
+    kernel()(b);
+}
+
+double LockIn::settleTime() const
+{
+    static const double taus[MAX_ORDER] = { 6.9, 9.2, 11.2, 13.1 };
+    return order_ > 0 ? taus[order_ - 1]*tau_ : 0.0;
+}
+
+void LockIn::result(uint32_t channel, double* x, double* y) const
+{
+    // the mixer's difference term carries half the amplitude
+    const double *last = &state_[(size_t)2*(order_ - 1)*channels_];
+    *x = 2.0*last[channel];
+    *y = 2.0*last[channels_ + channel];
+}
+
+void LockIn::polar(uint32_t channel, double* amplitude, double* phase) const
+{
+    double x, y;
+    result(channel, &x, &y);
+    *amplitude = sqrt(x*x + y*y);
+    *phase = atan2(y, x);
+}
+
+}
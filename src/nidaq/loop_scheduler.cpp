@@ -0,0 +1,87 @@
+#include "nidaq/loop_scheduler.h"
+
+#include <errno.h>
+#include <time.h>
+
+namespace nidaq {
+
+int64_t monotonicNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec*1000000000LL + now.tv_nsec;
+}
+
+static void sleepUntil(int64_t deadline)
+{
+    struct timespec ts;
+    ts.tv_sec = deadline / 1000000000LL;
+    ts.tv_nsec = deadline % 1000000000LL;
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+LoopScheduler::LoopScheduler(double rateHz, Policy policy)
+    : period_((int64_t)(1e9 / rateHz)), deadline_(0), policy_(policy)
+{
+    resetStats();
+}
+
+void LoopScheduler::start()
+{
+    deadline_ = monotonicNs() + period_;
+}
+
+void LoopScheduler::wait()
+{
+    int64_t now = monotonicNs();
+
+    stats_.loops++;
+    if(now > deadline_){
+        stats_.missed++;
+        if(policy_ == SKIP){
+            int64_t behind = (now - deadline_) / period_ + 1;
+            stats_.skipped += behind;
+            deadline_ += behind*period_;
+        }
+    }
+    if(now < deadline_)
+        sleepUntil(deadline_);
+
+    jitterAdd(&stats_.lateness, (monotonicNs() - deadline_) / 1e3);
+    deadline_ += period_;
+}
+
+void LoopScheduler::hardwareTick(uint64_t backlogSamples, double sampleRate, uint64_t samplesPerLoop)
+{
+    stats_.loops++;
+    if(backlogSamples >= samplesPerLoop)
+        stats_.missed++;
+    jitterAdd(&stats_.lateness, backlogSamples / sampleRate * 1e6);
+}
+
+void LoopScheduler::resetStats()
+{
+    stats_.loops = 0;
+    stats_.missed = 0;
+    stats_.skipped = 0;
+    jitterReset(&stats_.lateness);
+}
+
+void LoopScheduler::printStats(const char* label) const
+{
+    ROS_INFO("%s: %llu loops, %llu missed deadlines, %llu skipped slots", label,
+        (unsigned long long)stats_.loops, (unsigned long long)stats_.missed, (unsigned long long)stats_.skipped);
+    jitterPrint(label, stats_.lateness);
+}
+
+LoopScheduler::Policy LoopScheduler::parsePolicy(const std::string& name)
+{
+    if(name == "skip")
+        return SKIP;
+    if(name != "catch_up")
+        ROS_WARN("Unknown loop policy '%s', using catch_up", name.c_str());
+    return CATCH_UP;
+}
+
+}
@@ -0,0 +1,181 @@
+#include "nidaq/rt_profile.h"
+
+#include <alloca.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace nidaq {
+
+#define HUGEPAGE_SIZE (2u*1024u*1024u)
+
+void loadRtProfile(const ros::NodeHandle& nh, RtProfile* profile)
+{
+    int prefault;
+
+    nh.param("rt/enabled", profile->enabled, false);
+    nh.param("rt/priority", profile->priority, 80);
+    nh.param("rt/cpu", profile->cpu, -1);
+    nh.param("rt/lock_memory", profile->lockMemory, true);
+    nh.param("rt/prefault_stack", prefault, 512*1024);
+    nh.param("rt/hugepages", profile->hugepages, false);
+    nh.param("rt/jitter_loops", profile->jitterLoops, 2000);
+
+    profile->prefaultStack = prefault > 0 ? (size_t)prefault : 0;
+}
+
+static void prefaultStack(size_t bytes)
+{
+    volatile unsigned char *stack;
+    size_t page = sysconf(_SC_PAGESIZE);
+
+    if(bytes == 0)
+        return;
+    stack = (volatile unsigned char *)alloca(bytes);
+    for(size_t i = 0; i < bytes; i += page)
+        stack[i] = 0;
+}
+
+int applyRtProfile(const RtProfile& profile)
+{
+    int result = 0;
+    int err;
+
+    if(!profile.enabled)
+        return 0;
+
+    if(profile.lockMemory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0){
+        result = errno;
+        ROS_WARN("rt: mlockall failed: %s", strerror(errno));
+    }
+
+    if(profile.cpu >= 0){
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(profile.cpu, &set);
+        if((err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) != 0){
+            result = err;
+            ROS_WARN("rt: cannot pin to CPU %d: %s", profile.cpu, strerror(err));
+        }
+    }
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = profile.priority;
+    if((err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) != 0){
+        result = err;
+        ROS_WARN("rt: SCHED_FIFO priority %d refused: %s (needs CAP_SYS_NICE or rtprio limit)", profile.priority, strerror(err));
+    }
+
+    prefaultStack(profile.prefaultStack);
+
+    ROS_INFO("rt: profile applied (prio %d, cpu %d, mlock %d, stack %lu, hugepages %d)",
+        profile.priority, profile.cpu, (int)profile.lockMemory, (unsigned long)profile.prefaultStack, (int)profile.hugepages);
+    return result;
+}
+
+static size_t roundUp(size_t bytes, size_t unit)
+{
+    return (bytes + unit - 1) / unit * unit;
+}
+
+void* rtAlloc(size_t bytes, const RtProfile& profile, size_t* mapped)
+{
+    void *buffer = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if(profile.enabled && profile.hugepages){
+        *mapped = roundUp(bytes, HUGEPAGE_SIZE);
+        buffer = mmap(NULL, *mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(buffer == MAP_FAILED)
+            ROS_WARN("rt: no hugepages for %lu byte buffer, using normal pages", (unsigned long)bytes);
+    }
+#endif
+    if(buffer == MAP_FAILED){
+        *mapped = roundUp(bytes, sysconf(_SC_PAGESIZE));
+        buffer = mmap(NULL, *mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if(buffer == MAP_FAILED){
+        *mapped = 0;
+        return NULL;
+    }
+
+    memset(buffer, 0, *mapped);	//prefault
+    if(profile.enabled && profile.lockMemory)
+        mlock(buffer, *mapped);
+    return buffer;
+}
+
+void rtFree(void* buffer, size_t mapped)
+{
+    if(buffer != NULL)
+        munmap(buffer, mapped);
+}
+
+void jitterReset(JitterStats* stats)
+{
+    stats->count = 0;
+    stats->min = 1e300;
+    stats->max = 0;
+    stats->sum = 0;
+    stats->sumSq = 0;
+}
+
+void jitterAdd(JitterStats* stats, double latenessUs)
+{
+    stats->count++;
+    if(latenessUs < stats->min)
+        stats->min = latenessUs;
+    if(latenessUs > stats->max)
+        stats->max = latenessUs;
+    stats->sum += latenessUs;
+    stats->sumSq += latenessUs*latenessUs;
+}
+
+double jitterStdDev(const JitterStats& stats)
+{
+    if(stats.count < 2)
+        return 0;
+    double mean = stats.sum / stats.count;
+    double var = stats.sumSq / stats.count - mean*mean;
+    return var > 0 ? sqrt(var) : 0;
+}
+
+void jitterPrint(const char* label, const JitterStats& stats)
+{
+    if(stats.count == 0){
+        ROS_INFO("%s: no samples", label);
+        return;
+    }
+    ROS_INFO("%s: %llu wakeups, lateness min %.1f us, mean %.1f us, max %.1f us, stddev %.1f us",
+        label, (unsigned long long)stats.count, stats.min, stats.sum / stats.count, stats.max, jitterStdDev(stats));
+}
+
+JitterStats measureJitter(double rateHz, int loops)
+{
+    JitterStats stats;
+    struct timespec deadline, now;
+    long period = (long)(1e9 / rateHz);
+
+    jitterReset(&stats);
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    for(int i = 0; i < loops; i++){
+        deadline.tv_nsec += period;
+        while(deadline.tv_nsec >= 1000000000L){
+            deadline.tv_nsec -= 1000000000L;
+            deadline.tv_sec++;
+        }
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+            ;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        jitterAdd(&stats, ((now.tv_sec - deadline.tv_sec)*1e9 + (now.tv_nsec - deadline.tv_nsec)) / 1e3);
+    }
+    return stats;
+}
+
+}
@@ -0,0 +1,114 @@
+#include "nidaq/sample_clock.h"
+
+#include <math.h>
+
+namespace nidaq {
+
+SampleClock::SampleClock(double sampleRate, size_t window)
+    : nominalRate_(sampleRate), period_(1.0/sampleRate), offset_(0),
+      samples_(window < 2 ? 2 : window), times_(window < 2 ? 2 : window), count_(0), next_(0), sinceFit_(0)
+{
+}
+
+double SampleClock::fit(double period, bool lowerOnly) const
+{
+    double meanS = 0, meanT = 0, meanR = 0;
+    size_t used = 0;
+
+    if(lowerOnly){
+        for(size_t i = 0; i < count_; i++)
+            meanR += times_[i] - samples_[i]*period;
+        meanR /= count_;
+    }
+    for(size_t i = 0; i < count_; i++){
+        if(lowerOnly && times_[i] - samples_[i]*period > meanR)
+            continue;
+        meanS += samples_[i];
+        meanT += times_[i];
+        used++;
+    }
+    if(used < 2)
+        return period;
+    meanS /= used;
+    meanT /= used;
+
+    double sst = 0, ss = 0;
+    for(size_t i = 0; i < count_; i++){
+        if(lowerOnly && times_[i] - samples_[i]*period > meanR)
+            continue;
+        double ds = samples_[i] - meanS;
+        sst += ds*(times_[i] - meanT);
+        ss += ds*ds;
+    }
+    return ss > 0 ? sst / ss : period;
+}
+
+void SampleClock::update(uint64_t samplesAcquired, const ros::Time& readDone)
+{
+    if(count_ == 0)
+        anchor_ = readDone;
+
+    // the newest sample in the buffer was taken at or just before readDone
+    samples_[next_] = samplesAcquired > 0 ? (double)(samplesAcquired - 1) : 0.0;
+    times_[next_] = (readDone - anchor_).toSec();
+    next_ = (next_ + 1) % samples_.size();
+    if(count_ < samples_.size())
+        count_++;
+
+    size_t n = count_;
+    size_t newest = (next_ + samples_.size() - 1) % samples_.size();
+    bool refit = n <= samples_.size()/2 || ++sinceFit_ >= REFIT_EVERY;
+    if(n >= 2 && refit){
+        // plain least squares first, then refit on the observations that
+        // lie on or below that line: those carry the least latency
+        double fitted = fit(period_, false);
+        fitted = fit(fitted, true);
+        fitted = fit(fitted, true);
+        sinceFit_ = 0;
+
+        // keep the fit within 1000 ppm of the board rate, anything further
+        // is a stall or a restart rather than the board clock
+        double nominal = 1.0/nominalRate_;
+        if(fitted > nominal*0.999 && fitted < nominal*1.001)
+            period_ = fitted;
+
+        // least-late observation anchors the line
+        double best = times_[0] - samples_[0]*period_;
+        for(size_t i = 1; i < n; i++){
+            double o = times_[i] - samples_[i]*period_;
+            if(o < best)
+                best = o;
+        }
+        offset_ = best;
+    }else{
+        // same period until the next refit: only the new observation can
+        // be less late. One that dropped out of the window may anchor the
+        // line until then.
+        double o = times_[newest] - samples_[newest]*period_;
+        if(n == 1 || o < offset_)
+            offset_ = o;
+    }
+}
+
+void SampleClock::reset(uint64_t firstSample, const ros::Time& firstSampleTime)
+{
+    count_ = 0;
+    next_ = 0;
+    sinceFit_ = 0;
+    anchor_ = firstSampleTime;
+    offset_ = -(double)firstSample*period_;
+}
+
+double boardSampleRate(double requested, double timebase)
+{
+    if(requested <= 0 || requested >= timebase)
+        return requested;
+    return timebase/floor(timebase/requested + 0.5);
+}
+
+ros::Time SampleClock::stamp(uint64_t sampleIndex) const
+{
+    return anchor_ + ros::Duration(offset_ + (double)sampleIndex*period_);
+}
+
+}
@@ -0,0 +1,42 @@
+#include "nidaq/shape_kernels.h"
+
+namespace nidaq {
+
+#define NIDAQ_SHAPE_ROW(C) \
+    { &ScanKernels<C, 1>::KERNEL, &ScanKernels<C, 2>::KERNEL, &ScanKernels<C, 4>::KERNEL, \
+      &ScanKernels<C, 8>::KERNEL, &ScanKernels<C, 16>::KERNEL, &ScanKernels<C, 32>::KERNEL, \
+      &ScanKernels<C, 64>::KERNEL, &ScanKernels<C, 128>::KERNEL, &ScanKernels<C, 256>::KERNEL, \
+      &ScanKernels<C, 512>::KERNEL, &ScanKernels<C, 1024>::KERNEL, &ScanKernels<C, 2048>::KERNEL, \
+      &ScanKernels<C, 4096>::KERNEL }
+
+#define NIDAQ_SHAPE_SCANS   13      // 1..4096
+
+#define KERNEL deinterleave
+static const BlockKernelFn deinterleaveTable[4][NIDAQ_SHAPE_SCANS] = {
+    NIDAQ_SHAPE_ROW(1), NIDAQ_SHAPE_ROW(8), NIDAQ_SHAPE_ROW(16), NIDAQ_SHAPE_ROW(32)
+};
+#undef KERNEL
+
+// row and column in the table, false if the shape was not instantiated
+static bool shapeIndex(uint32_t channels, uint32_t scans, int* row, int* col)
+{
+    switch(channels){
+    case 1:  *row = 0; break;
+    case 8:  *row = 1; break;
+    case 16: *row = 2; break;
+    case 32: *row = 3; break;
+    default: return false;
+    }
+    if(scans == 0 || (scans & (scans - 1)) != 0 || scans > 4096)
+        return false;
+    *col = __builtin_ctz(scans);
+    return true;
+}
+
+BlockKernelFn deinterleaveFor(uint32_t channels, uint32_t scans)
+{
+    int row, col;
+    return shapeIndex(channels, scans, &row, &col) ? deinterleaveTable[row][col] : NULL;
+}
+
+}
@@ -0,0 +1,303 @@
+#include "nidaq/shm_ring.h"
+
+#include "ros/ros.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace nidaq {
+
+static std::string shmName(const std::string& name)
+{
+    return name.empty() || name[0] == '/' ? name : "/" + name;
+}
+
+static size_t slotBytesFor(uint32_t channels, uint32_t maxScans)
+{
+    size_t bytes = sizeof(ShmSlot) + (size_t)channels*maxScans*sizeof(float);
+    return (bytes + 63) / 64 * 64;
+}
+
+static ShmSlot* slotAt(ShmRingHeader* header, uint64_t blockSeq)
+{
+    return (ShmSlot *)((char *)(header + 1) + (size_t)(blockSeq % header->slotCount)*header->slotBytes);
+}
+
+static int futexCall(std::atomic<uint32_t>* word, int op, uint32_t value, const struct timespec* timeout)
+{
+    return syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), op, value, timeout, NULL, 0);
+}
+
+/*********************************************************************
+*    Writer
+*********************************************************************/
+ShmRingWriter::ShmRingWriter()
+    : header_(NULL), mapped_(0), current_(0)
+{
+}
+
+ShmRingWriter::~ShmRingWriter()
+{
+    close();
+}
+
+bool ShmRingWriter::open(const std::string& name, uint32_t slotCount, uint32_t channels, uint32_t maxScans,
+                         unsigned int mode)
+{
+    close();
+    if(slotCount < 2 || channels == 0 || maxScans == 0){
+        ROS_ERROR("shm: bad ring geometry (%u slots, %u channels, %u scans)", slotCount, channels, maxScans);
+        return false;
+    }
+    name_ = shmName(name);
+    size_t slotBytes = slotBytesFor(channels, maxScans);
+    size_t bytes = sizeof(ShmRingHeader) + slotBytes*slotCount;
+
+    // readers still mapping an old ring keep it until they detach
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, (mode_t)(mode & 0666));
+    if(fd < 0){
+        ROS_ERROR("shm: cannot create %s: %s", name_.c_str(), strerror(errno));
+        return false;
+    }
+    fchmod(fd, (mode_t)(mode & 0666));     // exactly mode, whatever the umask
+    if(ftruncate(fd, bytes) != 0){
+        ROS_ERROR("shm: cannot size %s to %lu bytes: %s", name_.c_str(), (unsigned long)bytes, strerror(errno));
+        ::close(fd);
+        shm_unlink(name_.c_str());
+        return false;
+    }
+    void *map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED){
+        ROS_ERROR("shm: cannot map %s: %s", name_.c_str(), strerror(errno));
+        shm_unlink(name_.c_str());
+        return false;
+    }
+
+    header_ = (ShmRingHeader *)map;
+    mapped_ = bytes;
+    current_ = 0;
+    header_->version = NIDAQ_SHM_VERSION;
+    header_->slotCount = slotCount;
+    header_->channels = channels;
+    header_->maxScans = maxScans;
+    header_->slotBytes = slotBytes;
+    // the file starts zeroed, so every slot and cursor already reads as empty/free;
+    // the magic goes in last so a reader never sees a half-initialized header
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = NIDAQ_SHM_MAGIC;
+
+    ROS_INFO("shm: ring %s, %u slots of %u x %u samples (%lu KiB)", name_.c_str(), slotCount, maxScans, channels, (unsigned long)(bytes >> 10));
+    return true;
+}
+
+void ShmRingWriter::close()
+{
+    if(header_ == NULL)
+        return;
+    munmap(header_, mapped_);
+    shm_unlink(name_.c_str());
+    header_ = NULL;
+}
+
+ShmSlot* ShmRingWriter::slot(uint64_t blockSeq) const
+{
+    return slotAt(header_, blockSeq);
+}
+
+float* ShmRingWriter::begin(uint64_t* blockSeq)
+{
+    current_ = header_->written.load(std::memory_order_relaxed);
+    ShmSlot *s = slot(current_);
+    s->seq.store(2*current_ + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    if(blockSeq != NULL)
+        *blockSeq = current_;
+    return (float *)(s + 1);
+}
+
+void ShmRingWriter::commit(uint32_t scans, int64_t stampNs, double samplePeriod, uint32_t gapSamples, uint8_t layout)
+{
+    ShmSlot *s = slot(current_);
+    s->blockSeq = current_;
+    s->stampNs = stampNs;
+    s->samplePeriod = samplePeriod;
+    s->scans = scans < header_->maxScans ? scans : header_->maxScans;
+    s->gapSamples = gapSamples;
+    s->layout = layout;
+    s->seq.store(2*current_ + 2, std::memory_order_release);
+    header_->written.store(current_ + 1, std::memory_order_release);
+
+    header_->futex.fetch_add(1, std::memory_order_release);
+    if(header_->waiters.load(std::memory_order_acquire) > 0)
+        futexCall(&header_->futex, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+uint64_t ShmRingWriter::maxReaderLag(uint64_t* lost) const
+{
+    uint64_t written = header_->written.load(std::memory_order_acquire);
+    uint64_t lag = 0, total = 0;
+    for(int i = 0; i < NIDAQ_SHM_MAX_READERS; i++){
+        const ShmReaderCursor& c = header_->readers[i];
+        if(c.pid.load(std::memory_order_relaxed) == 0)
+            continue;
+        uint64_t next = c.next.load(std::memory_order_relaxed);
+        if(written > next && written - next > lag)
+            lag = written - next;
+        total += c.lost.load(std::memory_order_relaxed);
+    }
+    if(lost != NULL)
+        *lost = total;
+    return lag;
+}
+
+/*********************************************************************
+*    Reader
+*********************************************************************/
+ShmRingReader::ShmRingReader()
+    : header_(NULL), mapped_(0), cursor_(-1), next_(0)
+{
+}
+
+ShmRingReader::~ShmRingReader()
+{
+    detach();
+}
+
+bool ShmRingReader::attach(const std::string& name)
+{
+    detach();
+    std::string path = shmName(name);
+    int fd = shm_open(path.c_str(), O_RDWR, 0);
+    if(fd < 0){
+        ROS_ERROR("shm: cannot open %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmRingHeader)){
+        ROS_ERROR("shm: %s is not a sample ring", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED){
+        ROS_ERROR("shm: cannot map %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    header_ = (ShmRingHeader *)map;
+    mapped_ = st.st_size;
+
+    uint32_t magic = header_->magic;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(magic != NIDAQ_SHM_MAGIC || header_->version != NIDAQ_SHM_VERSION ||
+       sizeof(ShmRingHeader) + (size_t)header_->slotBytes*header_->slotCount > mapped_){
+        ROS_ERROR("shm: %s is not a version %d sample ring (or not initialized yet)", path.c_str(), NIDAQ_SHM_VERSION);
+        detach();
+        return false;
+    }
+
+    // claim a free cursor, or one left behind by a reader that died
+    int32_t self = getpid();
+    for(int i = 0; i < NIDAQ_SHM_MAX_READERS && cursor_ < 0; i++){
+        int32_t owner = header_->readers[i].pid.load(std::memory_order_relaxed);
+        if(owner != 0 && !(kill(owner, 0) != 0 && errno == ESRCH))
+            continue;
+        if(header_->readers[i].pid.compare_exchange_strong(owner, self))
+            cursor_ = i;
+    }
+    if(cursor_ < 0){
+        ROS_ERROR("shm: %s already has %d readers", path.c_str(), NIDAQ_SHM_MAX_READERS);
+        detach();
+        return false;
+    }
+    next_ = header_->written.load(std::memory_order_acquire);
+    header_->readers[cursor_].next.store(next_, std::memory_order_relaxed);
+    header_->readers[cursor_].lost.store(0, std::memory_order_relaxed);
+    return true;
+}
+
+void ShmRingReader::detach()
+{
+    if(header_ == NULL)
+        return;
+    if(cursor_ >= 0)
+        header_->readers[cursor_].pid.store(0, std::memory_order_release);
+    munmap(header_, mapped_);
+    header_ = NULL;
+    cursor_ = -1;
+}
+
+const ShmSlot* ShmRingReader::slot(uint64_t blockSeq) const
+{
+    return slotAt(header_, blockSeq);
+}
+
+ShmRingReader::Status ShmRingReader::next(ShmBlockView* view, uint64_t* lost)
+{
+    uint64_t written = header_->written.load(std::memory_order_acquire);
+    if(next_ >= written)
+        return EMPTY;
+
+    // the slot of block written - slotCount is the one being rewritten now
+    if(written - next_ >= header_->slotCount){
+        uint64_t oldest = written - header_->slotCount + 1;
+        if(lost != NULL)
+            *lost = oldest - next_;
+        header_->readers[cursor_].lost.fetch_add(oldest - next_, std::memory_order_relaxed);
+        next_ = oldest;
+        header_->readers[cursor_].next.store(next_, std::memory_order_relaxed);
+        return LOST;
+    }
+
+    const ShmSlot *s = slot(next_);
+    if(s->seq.load(std::memory_order_acquire) != 2*next_ + 2)
+        return EMPTY;
+    view->blockSeq = next_;
+    view->stampNs = s->stampNs;
+    view->samplePeriod = s->samplePeriod;
+    view->channels = header_->channels;
+    view->scans = s->scans;
+    view->gapSamples = s->gapSamples;
+    view->layout = s->layout;
+    view->data = (const float *)(s + 1);
+    view->slot = s;
+    if(!valid(*view)){
+        // lapped between the checks above; report it on the next call
+        return next(view, lost);
+    }
+
+    next_++;
+    header_->readers[cursor_].next.store(next_, std::memory_order_relaxed);
+    return BLOCK;
+}
+
+bool ShmRingReader::valid(const ShmBlockView& view) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return view.slot->seq.load(std::memory_order_relaxed) == 2*view.blockSeq + 2;
+}
+
+void ShmRingReader::wait(double timeoutSec)
+{
+    uint32_t seen = header_->futex.load(std::memory_order_acquire);
+    if(header_->written.load(std::memory_order_acquire) > next_)
+        return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)timeoutSec;
+    ts.tv_nsec = (long)((timeoutSec - ts.tv_sec)*1e9);
+    header_->waiters.fetch_add(1, std::memory_order_acq_rel);
+    futexCall(&header_->futex, FUTEX_WAIT, seen, &ts);
+    header_->waiters.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+}
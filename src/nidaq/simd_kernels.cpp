@@ -0,0 +1,268 @@
+#include "nidaq/simd_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NIDAQ_X86 1
+#include <immintrin.h>
+#endif
+
+namespace nidaq {
+
+/*********************************************************************
+*    Scalar versions, also used for the edges of the vector versions
+*********************************************************************/
+static void narrowScalar(const double* in, float* out, size_t n)
+{
+    for(size_t i = 0; i < n; i++)
+        out[i] = (float)in[i];
+}
+
+static void scaleI16Scalar(const int16_t* in, float* out, size_t n, float gain, float offset)
+{
+    for(size_t i = 0; i < n; i++)
+        out[i] = gain*in[i] + offset;
+}
+
+static void deinterleaveTile(const double* in, uint32_t scans, uint32_t channels, float* out,
+                             uint32_t s0, uint32_t s1, uint32_t c0, uint32_t c1)
+{
+    for(uint32_t c = c0; c < c1; c++)
+        for(uint32_t s = s0; s < s1; s++)
+            out[(size_t)c*scans + s] = (float)in[(size_t)s*channels + c];
+}
+
+static void interleaveTile(const double* in, uint32_t scans, uint32_t channels, double* out,
+                           uint32_t s0, uint32_t s1, uint32_t c0, uint32_t c1)
+{
+    for(uint32_t s = s0; s < s1; s++)
+        for(uint32_t c = c0; c < c1; c++)
+            out[(size_t)s*channels + c] = in[(size_t)c*scans + s];
+}
+
+static void deinterleaveScalar(const double* in, uint32_t scans, uint32_t channels, float* out)
+{
+    deinterleaveTile(in, scans, channels, out, 0, scans, 0, channels);
+}
+
+static void interleaveScalar(const double* in, uint32_t scans, uint32_t channels, double* out)
+{
+    interleaveTile(in, scans, channels, out, 0, scans, 0, channels);
+}
+
+#ifdef NIDAQ_X86
+/*********************************************************************
+*    SSE2, baseline on x86-64
+*********************************************************************/
+static void narrowSse2(const double* in, float* out, size_t n)
+{
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(in + i));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(in + i + 2));
+        _mm_storeu_ps(out + i, _mm_movelh_ps(lo, hi));
+    }
+    narrowScalar(in + i, out + i, n - i);
+}
+
+static void scaleI16Sse2(const int16_t* in, float* out, size_t n, float gain, float offset)
+{
+    __m128 g = _mm_set1_ps(gain);
+    __m128 o = _mm_set1_ps(offset);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m128i raw = _mm_loadu_si128((const __m128i *)(in + i));
+        // sign-extend by placing each int16 in the top half and shifting down
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(raw, raw), 16);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo), g), o));
+        _mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), g), o));
+    }
+    scaleI16Scalar(in + i, out + i, n - i, gain, offset);
+}
+
+// columns c0..channels, so the AVX2 version can hand over its leftover channels
+static void deinterleaveSse2From(const double* in, uint32_t scans, uint32_t channels, float* out, uint32_t c0)
+{
+    uint32_t s2 = scans & ~1u, c2 = c0 + ((channels - c0) & ~1u);
+    for(uint32_t s = 0; s < s2; s += 2){
+        for(uint32_t c = c0; c < c2; c += 2){
+            __m128d r0 = _mm_loadu_pd(in + (size_t)s*channels + c);
+            __m128d r1 = _mm_loadu_pd(in + (size_t)(s + 1)*channels + c);
+            _mm_storel_pi((__m64 *)(out + (size_t)c*scans + s), _mm_cvtpd_ps(_mm_unpacklo_pd(r0, r1)));
+            _mm_storel_pi((__m64 *)(out + (size_t)(c + 1)*scans + s), _mm_cvtpd_ps(_mm_unpackhi_pd(r0, r1)));
+        }
+    }
+    deinterleaveTile(in, scans, channels, out, 0, s2, c2, channels);
+    deinterleaveTile(in, scans, channels, out, s2, scans, c0, channels);
+}
+
+static void deinterleaveSse2(const double* in, uint32_t scans, uint32_t channels, float* out)
+{
+    deinterleaveSse2From(in, scans, channels, out, 0);
+}
+
+static void interleaveSse2From(const double* in, uint32_t scans, uint32_t channels, double* out, uint32_t c0)
+{
+    uint32_t s2 = scans & ~1u, c2 = c0 + ((channels - c0) & ~1u);
+    for(uint32_t c = c0; c < c2; c += 2){
+        for(uint32_t s = 0; s < s2; s += 2){
+            __m128d r0 = _mm_loadu_pd(in + (size_t)c*scans + s);
+            __m128d r1 = _mm_loadu_pd(in + (size_t)(c + 1)*scans + s);
+            _mm_storeu_pd(out + (size_t)s*channels + c, _mm_unpacklo_pd(r0, r1));
+            _mm_storeu_pd(out + (size_t)(s + 1)*channels + c, _mm_unpackhi_pd(r0, r1));
+        }
+    }
+    interleaveTile(in, scans, channels, out, 0, s2, c2, channels);
+    interleaveTile(in, scans, channels, out, s2, scans, c0, channels);
+}
+
+static void interleaveSse2(const double* in, uint32_t scans, uint32_t channels, double* out)
+{
+    interleaveSse2From(in, scans, channels, out, 0);
+}
+
+/*********************************************************************
+*    AVX2
+*********************************************************************/
+#define NIDAQ_AVX2 __attribute__((target("avx2")))
+
+// 4x4 transpose of doubles held in four rows
+NIDAQ_AVX2 static inline void transpose4(__m256d& r0, __m256d& r1, __m256d& r2, __m256d& r3)
+{
+    __m256d t0 = _mm256_unpacklo_pd(r0, r1);   // r0[0] r1[0] r0[2] r1[2]
+    __m256d t1 = _mm256_unpackhi_pd(r0, r1);   // r0[1] r1[1] r0[3] r1[3]
+    __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+    __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+    r0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+    r1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+    r2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+    r3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+NIDAQ_AVX2 static void narrowAvx2(const double* in, float* out, size_t n)
+{
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(in + i));
+        __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(in + i + 4));
+        _mm256_storeu_ps(out + i, _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+    }
+    narrowScalar(in + i, out + i, n - i);
+}
+
+NIDAQ_AVX2 static void scaleI16Avx2(const int16_t* in, float* out, size_t n, float gain, float offset)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    __m256 o = _mm256_set1_ps(offset);
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16){
+        __m256i raw = _mm256_loadu_si256((const __m256i *)(in + i));
+        __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(raw));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(raw, 1));
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(lo), g), o));
+        _mm256_storeu_ps(out + i + 8, _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(hi), g), o));
+    }
+    scaleI16Scalar(in + i, out + i, n - i, gain, offset);
+}
+
+NIDAQ_AVX2 static void deinterleaveAvx2(const double* in, uint32_t scans, uint32_t channels, float* out)
+{
+    uint32_t s4 = scans & ~3u, c4 = channels & ~3u;
+    for(uint32_t s = 0; s < s4; s += 4){
+        const double *row = in + (size_t)s*channels;
+        for(uint32_t c = 0; c < c4; c += 4){
+            __m256d r0 = _mm256_loadu_pd(row + c);
+            __m256d r1 = _mm256_loadu_pd(row + channels + c);
+            __m256d r2 = _mm256_loadu_pd(row + 2*channels + c);
+            __m256d r3 = _mm256_loadu_pd(row + 3*channels + c);
+            transpose4(r0, r1, r2, r3);
+            _mm_storeu_ps(out + (size_t)c*scans + s, _mm256_cvtpd_ps(r0));
+            _mm_storeu_ps(out + (size_t)(c + 1)*scans + s, _mm256_cvtpd_ps(r1));
+            _mm_storeu_ps(out + (size_t)(c + 2)*scans + s, _mm256_cvtpd_ps(r2));
+            _mm_storeu_ps(out + (size_t)(c + 3)*scans + s, _mm256_cvtpd_ps(r3));
+        }
+    }
+    deinterleaveSse2From(in, scans, channels, out, c4);
+    deinterleaveTile(in, scans, channels, out, s4, scans, 0, c4);
+}
+
+NIDAQ_AVX2 static void interleaveAvx2(const double* in, uint32_t scans, uint32_t channels, double* out)
+{
+    uint32_t s4 = scans & ~3u, c4 = channels & ~3u;
+    for(uint32_t c = 0; c < c4; c += 4){
+        for(uint32_t s = 0; s < s4; s += 4){
+            __m256d r0 = _mm256_loadu_pd(in + (size_t)c*scans + s);
+            __m256d r1 = _mm256_loadu_pd(in + (size_t)(c + 1)*scans + s);
+            __m256d r2 = _mm256_loadu_pd(in + (size_t)(c + 2)*scans + s);
+            __m256d r3 = _mm256_loadu_pd(in + (size_t)(c + 3)*scans + s);
+            transpose4(r0, r1, r2, r3);
+            _mm256_storeu_pd(out + (size_t)s*channels + c, r0);
+            _mm256_storeu_pd(out + (size_t)(s + 1)*channels + c, r1);
+            _mm256_storeu_pd(out + (size_t)(s + 2)*channels + c, r2);
+            _mm256_storeu_pd(out + (size_t)(s + 3)*channels + c, r3);
+        }
+    }
+    interleaveSse2From(in, scans, channels, out, c4);
+    interleaveTile(in, scans, channels, out, s4, scans, 0, c4);
+}
+#endif
+
+/*********************************************************************
+*    Dispatch, resolved on first use
+*********************************************************************/
+struct SimdTable {
+    void (*narrow)(const double*, float*, size_t);
+    void (*scale)(const int16_t*, float*, size_t, float, float);
+    void (*deinterleave)(const double*, uint32_t, uint32_t, float*);
+    void (*interleave)(const double*, uint32_t, uint32_t, double*);
+    const char *level;
+};
+
+static SimdTable pickTable()
+{
+#ifdef NIDAQ_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        SimdTable t = { narrowAvx2, scaleI16Avx2, deinterleaveAvx2, interleaveAvx2, "avx2" };
+        return t;
+    }
+    if(__builtin_cpu_supports("sse2")){
+        SimdTable t = { narrowSse2, scaleI16Sse2, deinterleaveSse2, interleaveSse2, "sse2" };
+        return t;
+    }
+#endif
+    SimdTable t = { narrowScalar, scaleI16Scalar, deinterleaveScalar, interleaveScalar, "scalar" };
+    return t;
+}
+
+static const SimdTable& table()
+{
+    static const SimdTable t = pickTable();
+    return t;
+}
+
+void narrowF64(const double* in, float* out, size_t n)
+{
+    table().narrow(in, out, n);
+}
+
+void scaleI16(const int16_t* in, float* out, size_t n, float gain, float offset)
+{
+    table().scale(in, out, n, gain, offset);
+}
+
+void deinterleave(const double* in, uint32_t scans, uint32_t channels, float* out)
+{
+    table().deinterleave(in, scans, channels, out);
+}
+
+void interleave(const double* in, uint32_t scans, uint32_t channels, double* out)
+{
+    table().interleave(in, scans, channels, out);
+}
+
+const char* simdLevel()
+{
+    return table().level;
+}
+
+}
@@ -0,0 +1,118 @@
+#include "nidaq/stream_monitor.h"
+
+#include <algorithm>
+
+namespace nidaq {
+
+// 1-2-5 steps from 100 us to 10 s
+static const double latencyEdges[] = {
+    100e-6, 200e-6, 500e-6, 1e-3, 2e-3, 5e-3, 10e-3, 20e-3, 50e-3,
+    0.1, 0.2, 0.5, 1.0, 2.0, 5.0, 10.0
+};
+
+StreamMonitor::StreamMonitor()
+    : started_(false), expected_(0), last_(0),
+      edges_(latencyEdges, latencyEdges + sizeof(latencyEdges)/sizeof(latencyEdges[0]))
+{
+    histogram_.resize(edges_.size() + 1);
+    reset();
+}
+
+void StreamMonitor::reset()
+{
+    messages_ = 0;
+    samples_ = 0;
+    droppedMessages_ = 0;
+    droppedSamples_ = 0;
+    gapSamples_ = 0;
+    reordered_ = 0;
+    duplicates_ = 0;
+    latencyMin_ = 0;
+    latencyMax_ = 0;
+    latencySum_ = 0;
+    transportMax_ = 0;
+    transportSum_ = 0;
+    std::fill(histogram_.begin(), histogram_.end(), 0);
+}
+
+void StreamMonitor::update(uint64_t index, uint64_t samples, uint64_t gapSamples,
+                           const ros::Time& acquired, const ros::Time& published, const ros::Time& received)
+{
+    if(samples == 0)
+        samples = 1;
+
+    if(started_ && index == last_){
+        duplicates_++;
+        return;
+    }
+    if(started_ && index < last_ && index != 0){
+        // counted as lost when the stream moved past it
+        reordered_++;
+        if(droppedSamples_ >= samples){
+            droppedSamples_ -= samples;
+            if(droppedMessages_ > 0)
+                droppedMessages_--;
+        }
+    }else{
+        // in order; index 0 again means the publisher started over
+        if(started_ && index != 0 && index > expected_ + gapSamples){
+            uint64_t lost = index - expected_ - gapSamples;
+            droppedSamples_ += lost;
+            droppedMessages_ += (lost + samples - 1)/samples;
+        }
+        started_ = true;
+        last_ = index;
+        expected_ = index + samples;
+    }
+
+    messages_++;
+    samples_ += samples;
+    gapSamples_ += gapSamples;
+
+    double latency = (received - acquired).toSec();
+    double transport = (received - published).toSec();
+    if(messages_ == 1 || latency < latencyMin_)
+        latencyMin_ = latency;
+    if(messages_ == 1 || latency > latencyMax_)
+        latencyMax_ = latency;
+    latencySum_ += latency;
+    if(messages_ == 1 || transport > transportMax_)
+        transportMax_ = transport;
+    transportSum_ += transport;
+    histogram_[std::upper_bound(edges_.begin(), edges_.end(), latency) - edges_.begin()]++;
+}
+
+double StreamMonitor::percentile(double fraction) const
+{
+    // upper edge of the bin holding the fraction, the true maximum past the last edge
+    uint64_t rank = (uint64_t)(fraction*messages_ + 0.5);
+    uint64_t seen = 0;
+    for(size_t b = 0; b < edges_.size(); b++){
+        seen += histogram_[b];
+        if(seen >= rank && seen > 0)
+            return std::min(edges_[b], latencyMax_);
+    }
+    return latencyMax_;
+}
+
+void StreamMonitor::fill(streamStats* msg) const
+{
+    msg->messages = messages_;
+    msg->samples = samples_;
+    msg->dropped_messages = droppedMessages_;
+    msg->dropped_samples = droppedSamples_;
+    msg->gap_samples = gapSamples_;
+    msg->reordered = reordered_;
+    msg->duplicates = duplicates_;
+    msg->latency_min = latencyMin_;
+    msg->latency_max = latencyMax_;
+    msg->latency_mean = messages_ > 0 ? latencySum_/messages_ : 0;
+    msg->latency_p50 = percentile(0.5);
+    msg->latency_p99 = percentile(0.99);
+    msg->transport_mean = messages_ > 0 ? transportSum_/messages_ : 0;
+    msg->transport_max = transportMax_;
+    msg->latency_bin_edges = edges_;
+    msg->latency_histogram = histogram_;
+}
+
+}
@@ -0,0 +1,733 @@
+#include "nidaq/task_group.h"
+#include "nidaq/channels.h"
+#include "nidaq/loop_scheduler.h"
+#include "nidaq/sample_clock.h"
+#include "nidaq/simd_kernels.h"
+#include "nidaq/waveform.h"
+#include "nidaq/waveform_file.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+
+namespace nidaq {
+
+static pthread_mutex_t driverMutex = PTHREAD_MUTEX_INITIALIZER;
+
+DriverLock::DriverLock()
+{
+    pthread_mutex_lock(&driverMutex);
+}
+
+DriverLock::~DriverLock()
+{
+    pthread_mutex_unlock(&driverMutex);
+}
+
+TaskGroup::TaskGroup(const std::string& name, const std::string& type, int queue)
+    : task_(0), rate_(0), name_(name), type_(type), started_(false), failed_(false), running_(false),
+      notify_(NULL), filled_(queue > 1 ? queue : 2), free_(queue > 1 ? queue : 2)
+{
+    memset(&stats_, 0, sizeof(stats_));
+    resetRecoveryStats(&stats_.recovery);
+    snapshot_ = stats_;
+    pthread_mutex_init(&statsLock_, NULL);
+}
+
+TaskGroup::~TaskGroup()
+{
+    stop();
+    pthread_mutex_destroy(&statsLock_);
+}
+
+void* TaskGroup::operator new(size_t bytes)
+{
+    void *p;
+    if(posix_memalign(&p, 64, bytes) != 0)
+        throw std::bad_alloc();
+    return p;
+}
+
+void TaskGroup::operator delete(void* p)
+{
+    free(p);
+}
+
+bool TaskGroup::configure(const ros::NodeHandle& nh)
+{
+    loadRtProfile(nh, &rt_);
+    return setup(nh);
+}
+
+bool TaskGroup::start(sem_t* notify)
+{
+    int err;
+
+    if(started_)
+        return true;
+    notify_ = notify;
+    stats_.startSec = ros::WallTime::now().toSec();
+    stats_.samples = 0;
+    publishStats(true);     // no service thread yet
+    failed_.store(false, std::memory_order_release);
+    running_.store(true, std::memory_order_release);
+    if((err = pthread_create(&thread_, NULL, threadMain, this)) != 0){
+        ROS_ERROR("group %s: cannot start its thread: %s", name_.c_str(), strerror(err));
+        running_.store(false, std::memory_order_release);
+        return false;
+    }
+    started_ = true;
+    return true;
+}
+
+void TaskGroup::pause()
+{
+    running_.store(false, std::memory_order_release);
+    if(started_){
+        pthread_join(thread_, NULL);
+        started_ = false;
+    }
+    if(task_ != 0){
+        DriverLock lock;
+        DAQmxBaseStopTask(task_);
+    }
+}
+
+void TaskGroup::stop()
+{
+    pause();
+    if(task_ != 0){
+        DriverLock lock;
+        DAQmxBaseClearTask(task_);
+        task_ = 0;
+    }
+}
+
+void* TaskGroup::threadMain(void* arg)
+{
+    TaskGroup *group = (TaskGroup *)arg;
+
+    applyRtProfile(group->rt_);
+    if(!group->begin()){
+        group->failed_.store(true, std::memory_order_release);
+        group->running_.store(false, std::memory_order_release);
+        return NULL;
+    }
+    while(group->running()){
+        group->stats_.loops++;
+        if(!group->service()){
+            group->failed_.store(true, std::memory_order_release);
+            group->running_.store(false, std::memory_order_release);
+            break;
+        }
+        group->publishStats(false);
+    }
+    group->publishStats(true);
+    if(group->notify_ != NULL)
+        sem_post(group->notify_);   // let the publisher see a failure at once
+    return NULL;
+}
+
+void TaskGroup::publishStats(bool wait)
+{
+    if(wait)
+        pthread_mutex_lock(&statsLock_);
+    else if(pthread_mutex_trylock(&statsLock_) != 0)
+        return;     // a reader has it, the next loop copies again
+    snapshot_ = stats_;
+    pthread_mutex_unlock(&statsLock_);
+}
+
+TaskGroup::Stats TaskGroup::stats() const
+{
+    pthread_mutex_lock(&statsLock_);
+    Stats copy = snapshot_;
+    pthread_mutex_unlock(&statsLock_);
+    return copy;
+}
+
+double TaskGroup::achievedRate() const
+{
+    Stats s = stats();
+    double elapsed = ros::WallTime::now().toSec() - s.startSec;
+    return elapsed > 0 ? s.samples/elapsed : 0;
+}
+
+void TaskGroup::allocateBlocks(size_t channels, size_t scans)
+{
+    blocks_.resize(free_.capacity());
+    for(size_t i = 0; i < blocks_.size(); i++){
+        blocks_[i].channels = channels;
+        blocks_[i].data.resize(channels*scans);
+        free_.push(&blocks_[i]);
+    }
+}
+
+analogInputBlock* TaskGroup::acquire()
+{
+    analogInputBlock *block;
+    return free_.pop(&block) ? block : NULL;
+}
+
+void TaskGroup::submit(analogInputBlock* block)
+{
+    filled_.push(block);    // cannot be full: there are only as many blocks as slots
+    stats_.blocks++;
+    if(notify_ != NULL)
+        sem_post(notify_);
+}
+
+analogInputBlock* TaskGroup::pop()
+{
+    analogInputBlock *block;
+    return filled_.pop(&block) ? block : NULL;
+}
+
+void TaskGroup::recycle(analogInputBlock* block)
+{
+    free_.push(block);
+}
+
+void TaskGroup::sleepFor(double seconds)
+{
+    // short naps so stop() is never kept waiting on a slow group
+    if(seconds > 0.1)
+        seconds = 0.1;
+    if(seconds <= 0)
+        return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - ts.tv_sec)*1e9);
+    while(clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR)
+        ;
+}
+
+void TaskGroup::fail(int32 error)
+{
+    char errBuff[2048] = { '\0' };
+    {
+        DriverLock lock;
+        DAQmxBaseGetExtendedErrorInfo(errBuff, sizeof(errBuff));
+    }
+    ROS_ERROR("group %s: DAQmxBase Error %ld: %s", name_.c_str(), (long)error, errBuff);
+}
+
+/*********************************************************************
+*    Continuous AI. The next read is due when a whole block must be in
+*    the buffer; until then the thread sleeps, so the read itself finds
+*    its samples and returns without blocking.
+*********************************************************************/
+class AiGroup : public TaskGroup {
+public:
+    AiGroup(const std::string& name, int queue)
+        : TaskGroup(name, "ai", queue), blockSize_(1), channels_(0), totalRead_(0), pendingGap_(0), clock_(1.0),
+          min_(0), max_(0), restarted_(false) {}
+
+protected:
+    bool setup(const ros::NodeHandle& nh)
+    {
+        std::string chan, clockSource;
+        double minAI, maxAI;
+        int32 error;
+
+        nh.param("channels", chan, std::string("Dev1/ai0"));
+        nh.param("clock", clockSource, std::string("OnboardClock"));
+        nh.param("rate", rate_, 1000.0);
+        nh.param("block_size", blockSize_, 100);
+        nh.param("min", minAI, -10.0);
+        nh.param("max", maxAI, 10.0);
+        chan_ = chan;
+        clockSource_ = clockSource;
+        min_ = minAI;
+        max_ = maxAI;
+        channels_ = countChannels(chan);
+        if(channels_ == 0 || blockSize_ < 1 || rate_ <= 0){
+            ROS_ERROR("group %s: bad channel list, rate or block size", name().c_str());
+            return false;
+        }
+        uInt32 inputBuffer = bufferFor(blockSize_);
+        data_.resize(blockSize_*channels_);
+        clock_ = SampleClock(boardSampleRate(rate_));
+        allocateBlocks(channels_, blockSize_);
+
+        DriverLock lock;
+        if(DAQmxFailed(error = DAQmxBaseCreateTask("", &task_)) ||
+           DAQmxFailed(error = DAQmxBaseCreateAIVoltageChan(task_, chan.c_str(), "", DAQmx_Val_RSE, minAI, maxAI, DAQmx_Val_Volts, NULL)) ||
+           DAQmxFailed(error = DAQmxBaseCfgSampClkTiming(task_, clockSource.c_str(), rate_, DAQmx_Val_Rising, DAQmx_Val_ContSamps, inputBuffer)) ||
+           DAQmxFailed(error = DAQmxBaseCfgInputBuffer(task_, inputBuffer))){
+            char errBuff[2048] = { '\0' };
+            DAQmxBaseGetExtendedErrorInfo(errBuff, sizeof(errBuff));
+            ROS_ERROR("group %s: DAQmxBase Error %ld: %s", name().c_str(), (long)error, errBuff);
+            return false;
+        }
+        return true;
+    }
+
+    // only the rate changes in place: new channels, ranges or block sizes need a new task
+    bool retune(const ros::NodeHandle& nh)
+    {
+        std::string chan, clockSource;
+        double minAI, maxAI, rate;
+        int blockSize;
+        int32 error;
+
+        nh.param("channels", chan, std::string("Dev1/ai0"));
+        nh.param("clock", clockSource, std::string("OnboardClock"));
+        nh.param("rate", rate, 1000.0);
+        nh.param("block_size", blockSize, 100);
+        nh.param("min", minAI, -10.0);
+        nh.param("max", maxAI, 10.0);
+        if(chan != chan_ || clockSource != clockSource_ || minAI != min_ || maxAI != max_ || blockSize != blockSize_ || rate <= 0)
+            return false;
+
+        {
+            DriverLock lock;
+            error = DAQmxBaseCfgSampClkTiming(task_, clockSource.c_str(), rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, bufferFor(blockSize_));
+        }
+        if(DAQmxFailed(error)){
+            fail(error);
+            return false;
+        }
+        rate_ = rate;
+        clock_ = SampleClock(boardSampleRate(rate_));
+        return true;
+    }
+
+    bool begin()
+    {
+        int32 error;
+        {
+            DriverLock lock;
+            error = DAQmxBaseStartTask(task_);
+        }
+        if(DAQmxFailed(error)){
+            fail(error);
+            return false;
+        }
+        // the board counts from 0 again after a pause; the stream's index goes on
+        if(restarted_)
+            clock_.reset(totalRead_, ros::Time::now());
+        restarted_ = true;
+        return true;
+    }
+
+    bool service()
+    {
+        uInt32 avail;
+        int32 pointsRead = 0;
+        int32 error;
+        ros::Time now;
+        {
+            DriverLock lock;
+            error = DAQmxBaseGetReadAttribute(task_, DAQmx_Read_AvailSampPerChan, &avail);
+            now = ros::Time::now();
+            if(!DAQmxFailed(error) && avail >= (uInt32)blockSize_)
+                error = DAQmxBaseReadAnalogF64(task_, blockSize_, 0.0, DAQmx_Val_GroupByScanNumber, &data_[0], data_.size(), &pointsRead, NULL);
+        }
+        if(DAQmxFailed(error))
+            return recover(error);
+        if(pointsRead <= 0){
+            sleepFor((blockSize_ - avail)/rate_);
+            return true;
+        }
+        clock_.update(totalRead_ + avail, now);
+
+        analogInputBlock *block = acquire();
+        if(block == NULL){
+            stats_.dropped++;
+        }else{
+            block->header.stamp = clock_.stamp(totalRead_);
+            block->scans = pointsRead;
+            block->sample_period = clock_.period();
+            block->gap_samples = pendingGap_;
+            block->sample_index = totalRead_;
+            block->acquisition_time = block->header.stamp;
+            block->layout = analogInputBlock::SCAN_MAJOR;
+            narrowF64(&data_[0], &block->data[0], pointsRead*channels_);
+            submit(block);
+            pendingGap_ = 0;
+        }
+        totalRead_ += pointsRead;
+        stats_.samples += pointsRead;
+
+        // a whole block already waiting: read it right away
+        avail -= pointsRead;
+        if(avail < (uInt32)blockSize_)
+            sleepFor((blockSize_ - avail)/rate_);
+        return true;
+    }
+
+private:
+    bool recover(int32 error)
+    {
+        bool recovered;
+        {
+            DriverLock lock;
+            recovered = recoverTask(task_, error, &stats_.recovery);
+        }
+        if(!recovered){
+            fail(error);
+            return false;
+        }
+        if(classifyDaqError(error) == DAQ_OVERRUN){
+            ros::Time resumed = ros::Time::now();
+            uint64_t gap = (uint64_t)((resumed - clock_.stamp(totalRead_)).toSec()*rate_ + 0.5);
+            totalRead_ += gap;
+            pendingGap_ += gap;
+            stats_.recovery.gapSamples += gap;
+            clock_.reset(totalRead_, resumed);
+        }
+        return true;
+    }
+
+    static uInt32 bufferFor(int blockSize)
+    {
+        return blockSize*10 > 2000 ? blockSize*10 : 2000;
+    }
+
+    int                 blockSize_;
+    int                 channels_;
+    uint64_t            totalRead_;
+    uint64_t            pendingGap_;
+    SampleClock         clock_;
+    std::vector<double> data_;
+
+    // what the task was created with
+    std::string         chan_;
+    std::string         clockSource_;
+    double              min_, max_;
+    bool                restarted_;     // begin() has run before
+};
+
+/*********************************************************************
+*    Continuous AO. Waveforms are written once and regenerated by the
+*    board, the thread has nothing to do. A file is streamed instead:
+*    the thread writes the next chunk as soon as the host clock says
+*    there is room for it, so the write never waits inside the driver.
+*    A write that still finds the buffer full means the board clock
+*    is behind the host's, and the estimate is moved back a chunk.
+*********************************************************************/
+class AoGroup : public TaskGroup {
+public:
+    AoGroup(const std::string& name, int queue)
+        : TaskGroup(name, "ao", queue), channels_(0), scans_(0), chunk_(0), loop_(true), pos_(0), written_(0), startNs_(0),
+          min_(0), max_(0) {}
+
+    double achievedRate() const
+    {
+        return streaming() ? TaskGroup::achievedRate() : rate_;   // regeneration runs on the board
+    }
+
+protected:
+    bool setup(const ros::NodeHandle& nh)
+    {
+        std::string chan, path;
+        double minAO, maxAO;
+        int bufferChunks;
+        int32 error;
+
+        nh.param("channels", chan, std::string("Dev1/ao0"));
+        nh.param("rate", rate_, 1000.0);
+        nh.param("min", minAO, -10.0);
+        nh.param("max", maxAO, 10.0);
+        nh.param("file", path, std::string(""));
+        nh.param("loop", loop_, true);
+        nh.param("chunk", chunk_, 0);
+        nh.param("buffer_chunks", bufferChunks, 4);
+        chan_ = chan;
+        min_ = minAO;
+        max_ = maxAO;
+        channels_ = countChannels(chan);
+        if(channels_ == 0 || rate_ <= 0){
+            ROS_ERROR("group %s: bad channel list or rate", name().c_str());
+            return false;
+        }
+
+        if(!path.empty()){
+            if(!file_.open(path))
+                return false;
+            if((int)file_.channels() != channels_){
+                ROS_ERROR("group %s: %s has %u channels, ~channels has %d", name().c_str(), path.c_str(), file_.channels(), channels_);
+                return false;
+            }
+            if(chunk_ <= 0)
+                chunk_ = (int)(rate_/20) > 1 ? (int)(rate_/20) : 1;
+            scans_ = chunk_*(bufferChunks > 2 ? bufferChunks : 2);
+            data_.resize(scans_*channels_);
+        }else if(!loadWaveforms(nh, rate_)){
+            return false;
+        }
+
+        DriverLock lock;
+        if(DAQmxFailed(error = DAQmxBaseCreateTask("", &task_)) ||
+           DAQmxFailed(error = DAQmxBaseCreateAOVoltageChan(task_, chan.c_str(), "", minAO, maxAO, DAQmx_Val_Volts, NULL)) ||
+           DAQmxFailed(error = DAQmxBaseCfgSampClkTiming(task_, "OnboardClock", rate_, DAQmx_Val_Rising, DAQmx_Val_ContSamps, scans_))){
+            char errBuff[2048] = { '\0' };
+            DAQmxBaseGetExtendedErrorInfo(errBuff, sizeof(errBuff));
+            ROS_ERROR("group %s: DAQmxBase Error %ld: %s", name().c_str(), (long)error, errBuff);
+            return false;
+        }
+        if(streaming() && !disableRegeneration(task_))
+            return false;
+        return true;
+    }
+
+    // rate and waveforms change in place; a file, new channels or ranges need a new task
+    bool retune(const ros::NodeHandle& nh)
+    {
+        std::string chan, path;
+        double minAO, maxAO, rate;
+        int32 error;
+
+        nh.param("channels", chan, std::string("Dev1/ao0"));
+        nh.param("rate", rate, 1000.0);
+        nh.param("min", minAO, -10.0);
+        nh.param("max", maxAO, 10.0);
+        nh.param("file", path, std::string(""));
+        if(streaming() || !path.empty() || chan != chan_ || minAO != min_ || maxAO != max_ || rate <= 0)
+            return false;
+        if(!loadWaveforms(nh, rate))
+            return false;
+
+        {
+            DriverLock lock;
+            error = DAQmxBaseCfgSampClkTiming(task_, "OnboardClock", rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, scans_);
+        }
+        if(DAQmxFailed(error)){
+            fail(error);
+            return false;
+        }
+        rate_ = rate;
+        return true;
+    }
+
+    bool begin()
+    {
+        int32 error = prime();
+        if(DAQmxFailed(error)){
+            fail(error);
+            return false;
+        }
+        return true;
+    }
+
+    bool service()
+    {
+        if(!streaming()){
+            sleepFor(0.1);
+            return true;
+        }
+
+        int64_t played = (int64_t)((monotonicNs() - startNs_)*1e-9*rate_);
+        int64_t room = scans_ - ((int64_t)written_ - played);
+        if(room < chunk_){
+            sleepFor((chunk_ - room)/rate_);
+            return true;
+        }
+
+        fillFrom(chunk_);
+        int32 pointsWritten = 0;
+        int32 error;
+        {
+            DriverLock lock;
+            error = DAQmxBaseWriteAnalogF64(task_, chunk_, 0, 0.0, DAQmx_Val_GroupByScanNumber, &data_[0], &pointsWritten, NULL);
+        }
+        written_ += pointsWritten;
+        stats_.samples += pointsWritten;
+        if(!DAQmxFailed(error))
+            return true;
+
+        switch(classifyDaqError(error)){
+        case DAQ_TIMEOUT:
+            //the board is slower than the host clock: wait a chunk longer
+            stats_.recovery.timeouts++;
+            rewind(chunk_ - pointsWritten);
+            startNs_ += (int64_t)(1e9*chunk_/rate_);
+            return true;
+        case DAQ_UNDERRUN:
+            stats_.recovery.underruns++;
+            stats_.recovery.restarts++;
+            ROS_WARN("group %s: output underrun, restarting", name().c_str());
+            {
+                DriverLock lock;
+                DAQmxBaseStopTask(task_);
+            }
+            error = prime();
+            if(!DAQmxFailed(error))
+                return true;
+            // fall through
+        default:
+            fail(error);
+            return false;
+        }
+    }
+
+private:
+    bool streaming() const { return file_.scans() > 0; }
+
+    // the regenerated buffer from ~waveforms, ~scans and ~amplitude
+    bool loadWaveforms(const ros::NodeHandle& nh, double rate)
+    {
+        std::vector<std::string> specs;
+        double amplitude;
+        int scans;
+
+        nh.getParam("waveforms", specs);
+        nh.param("scans", scans, 0);
+        nh.param("amplitude", amplitude, 0.0);
+        if((int)specs.size() != channels_){
+            ROS_ERROR("group %s: ~waveforms needs one spec per channel (%d)", name().c_str(), channels_);
+            return false;
+        }
+        int n = scans > 0 ? scans : (int)rate;     //default: one second per buffer
+        std::vector<double> channelMajor(n*channels_);
+        for(int c = 0; c < channels_; c++){
+            WaveformSpec spec;
+            if(!parseWaveform(specs[c], &spec))
+                return false;
+            if(amplitude != 0 && spec.shape != WaveformSpec::DC)
+                spec.amplitude = amplitude;
+            fillWaveform(spec, &channelMajor[c*n], n);
+        }
+        scans_ = n;
+        data_.resize(scans_*channels_);
+        interleave(&channelMajor[0], scans_, channels_, &data_[0]);
+        return true;
+    }
+
+    // writes the whole buffer and starts the task
+    int32 prime()
+    {
+        int32 pointsWritten = 0;
+        int32 error;
+
+        if(streaming())
+            fillFrom(scans_);
+        DriverLock lock;
+        error = DAQmxBaseWriteAnalogF64(task_, scans_, 0, 1.0 + scans_/rate_, DAQmx_Val_GroupByScanNumber, &data_[0], &pointsWritten, NULL);
+        if(DAQmxFailed(error))
+            return error;
+        error = DAQmxBaseStartTask(task_);
+        startNs_ = monotonicNs();
+        written_ = pointsWritten;
+        return error;
+    }
+
+    void fillFrom(uint32_t count)
+    {
+        uint32_t done = 0;
+        while(done < count){
+            if(pos_ >= file_.scans())
+                pos_ = loop_ ? 0 : file_.scans() - 1;   //without looping the last scan is held
+            uint64_t n = file_.scans() - pos_;
+            if(n > count - done)
+                n = count - done;
+            file_.read(pos_, n, &data_[done*channels_]);
+            file_.release(pos_, n);
+            file_.prefetch(pos_ + n, (uint64_t)chunk_*4);
+            pos_ += n;
+            done += n;
+        }
+    }
+
+    void rewind(uint64_t count)
+    {
+        pos_ = pos_ >= count ? pos_ - count : file_.scans() - (count - pos_);
+    }
+
+    int                 channels_;
+    int                 scans_;         // AO buffer
+    int                 chunk_;
+    bool                loop_;
+    uint64_t            pos_;           // next file scan
+    uint64_t            written_;       // scans written since the task started
+    int64_t             startNs_;
+    WaveformFile        file_;
+    std::vector<double> data_;
+
+    // what the task was created with
+    std::string         chan_;
+    double              min_, max_;
+};
+
+/*********************************************************************
+*    Continuous pulse train (PWM). It runs on the counter by itself.
+*********************************************************************/
+class CoGroup : public TaskGroup {
+public:
+    CoGroup(const std::string& name, int queue) : TaskGroup(name, "co", queue) {}
+
+    double achievedRate() const { return rate_; }
+
+protected:
+    bool setup(const ros::NodeHandle& nh)
+    {
+        std::string counter;
+        double duty;
+        int32 error;
+
+        nh.param("counter", counter, std::string("Dev1/ctr0"));
+        nh.param("frequency", rate_, 1000.0);
+        nh.param("duty", duty, 0.5);
+
+        DriverLock lock;
+        if(DAQmxFailed(error = DAQmxBaseCreateTask("", &task_)) ||
+           DAQmxFailed(error = DAQmxBaseCreateCOPulseChanFreq(task_, counter.c_str(), "", DAQmx_Val_Hz, DAQmx_Val_Low, 0.0, rate_, duty)) ||
+           DAQmxFailed(error = DAQmxBaseCfgImplicitTiming(task_, DAQmx_Val_ContSamps, 1000))){
+            char errBuff[2048] = { '\0' };
+            DAQmxBaseGetExtendedErrorInfo(errBuff, sizeof(errBuff));
+            ROS_ERROR("group %s: DAQmxBase Error %ld: %s", name().c_str(), (long)error, errBuff);
+            return false;
+        }
+        return true;
+    }
+
+    bool begin()
+    {
+        int32 error;
+        {
+            DriverLock lock;
+            error = DAQmxBaseStartTask(task_);
+        }
+        if(DAQmxFailed(error)){
+            fail(error);
+            return false;
+        }
+        return true;
+    }
+
+    bool service()
+    {
+        sleepFor(0.1);
+        return true;
+    }
+};
+
+TaskGroup* createTaskGroup(const std::string& name, const ros::NodeHandle& nh)
+{
+    std::string type;
+    int queue;
+    TaskGroup *group;
+
+    nh.param("type", type, std::string(""));
+    nh.param("queue", queue, 16);
+    if(type == "ai")
+        group = new AiGroup(name, queue);
+    else if(type == "ao")
+        group = new AoGroup(name, queue);
+    else if(type == "co")
+        group = new CoGroup(name, queue);
+    else{
+        ROS_ERROR("group %s: unknown type '%s' (ai, ao or co)", name.c_str(), type.c_str());
+        return NULL;
+    }
+    if(!group->configure(nh)){
+        delete group;
+        return NULL;
+    }
+    return group;
+}
+
+}
@@ -0,0 +1,178 @@
+#include "nidaq/thread_pool.h"
+
+#include <string.h>
+#include <unistd.h>
+#include "ros/ros.h"
+
+namespace nidaq {
+
+ThreadPool::ThreadPool(int threads)
+    : generation_(0), active_(0), stopping_(false), fn_(NULL), ctx_(NULL), next_(1)
+{
+    int err;
+
+    if(threads <= 0)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(threads < 1)
+        threads = 1;
+
+    pthread_mutex_init(&lock_, NULL);
+    pthread_cond_init(&wake_, NULL);
+    pthread_cond_init(&idle_, NULL);
+    slices_.resize(threads);
+    for(size_t i = 0; i < slices_.size(); i++){
+        pthread_mutex_init(&slices_[i].lock, NULL);
+        slices_[i].begin = slices_[i].end = 0;
+    }
+
+    // slice 0 belongs to the thread calling run()
+    workers_.resize(threads - 1);
+    for(size_t i = 0; i < workers_.size(); i++){
+        if((err = pthread_create(&workers_[i], NULL, workerMain, this)) != 0){
+            ROS_WARN("thread pool: only %lu of %d threads started: %s", (unsigned long)i + 1, threads, strerror(err));
+            workers_.resize(i);
+            slices_.resize(i + 1);
+            break;
+        }
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    pthread_mutex_lock(&lock_);
+    stopping_ = true;
+    pthread_cond_broadcast(&wake_);
+    pthread_mutex_unlock(&lock_);
+    for(size_t i = 0; i < workers_.size(); i++)
+        pthread_join(workers_[i], NULL);
+
+    for(size_t i = 0; i < slices_.size(); i++)
+        pthread_mutex_destroy(&slices_[i].lock);
+    pthread_cond_destroy(&idle_);
+    pthread_cond_destroy(&wake_);
+    pthread_mutex_destroy(&lock_);
+}
+
+void ThreadPool::run(TaskFn fn, void* ctx, size_t count)
+{
+    size_t n = slices_.size();
+
+    if(n == 1 || count <= 1){
+        for(size_t i = 0; i < count; i++)
+            fn(ctx, i);
+        return;
+    }
+
+    pthread_mutex_lock(&lock_);
+    fn_ = fn;
+    ctx_ = ctx;
+    for(size_t k = 0; k < n; k++){
+        pthread_mutex_lock(&slices_[k].lock);
+        slices_[k].begin = count*k/n;
+        slices_[k].end = count*(k + 1)/n;
+        pthread_mutex_unlock(&slices_[k].lock);
+    }
+    active_ = (int)workers_.size();
+    generation_++;
+    pthread_cond_broadcast(&wake_);
+    pthread_mutex_unlock(&lock_);
+
+    work(0);
+
+    // every task is taken once all threads are out; wait for the last to finish
+    pthread_mutex_lock(&lock_);
+    while(active_ > 0)
+        pthread_cond_wait(&idle_, &lock_);
+    pthread_mutex_unlock(&lock_);
+}
+
+void* ThreadPool::workerMain(void* arg)
+{
+    ThreadPool *pool = (ThreadPool *)arg;
+    size_t self = pool->next_.fetch_add(1);
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->lock_);
+    for(;;){
+        while(pool->generation_ == seen && !pool->stopping_)
+            pthread_cond_wait(&pool->wake_, &pool->lock_);
+        if(pool->stopping_)
+            break;
+        seen = pool->generation_;
+        pthread_mutex_unlock(&pool->lock_);
+
+        pool->work(self);
+
+        pthread_mutex_lock(&pool->lock_);
+        if(--pool->active_ == 0)
+            pthread_cond_signal(&pool->idle_);
+    }
+    pthread_mutex_unlock(&pool->lock_);
+    return NULL;
+}
+
+void ThreadPool::work(size_t self)
+{
+    size_t index;
+
+    while(take(self, &index) || steal(self, &index))
+        fn_(ctx_, index);
+}
+
+bool ThreadPool::take(size_t slice, size_t* index)
+{
+    Slice& s = slices_[slice];
+    bool found = false;
+
+    pthread_mutex_lock(&s.lock);
+    if(s.begin < s.end){
+        *index = s.begin++;
+        found = true;
+    }
+    pthread_mutex_unlock(&s.lock);
+    return found;
+}
+
+bool ThreadPool::steal(size_t self, size_t* index)
+{
+    for(;;){
+        // the fullest slice; it may shrink once its lock is dropped, checked again below
+        size_t victim = self, most = 0;
+        for(size_t k = 0; k < slices_.size(); k++){
+            if(k == self)
+                continue;
+            pthread_mutex_lock(&slices_[k].lock);
+            size_t left = slices_[k].begin < slices_[k].end ? slices_[k].end - slices_[k].begin : 0;
+            pthread_mutex_unlock(&slices_[k].lock);
+            if(left > most){
+                most = left;
+                victim = k;
+            }
+        }
+        if(victim == self)
+            return false;
+
+        Slice& v = slices_[victim];
+        size_t begin = 0, end = 0;
+        pthread_mutex_lock(&v.lock);
+        if(v.begin < v.end){
+            size_t half = (v.end - v.begin + 1)/2;
+            end = v.end;
+            begin = end - half;
+            v.end = begin;
+        }
+        pthread_mutex_unlock(&v.lock);
+        if(begin == end)
+            continue;   // emptied meanwhile, look again
+
+        *index = begin;
+        Slice& own = slices_[self];
+        pthread_mutex_lock(&own.lock);
+        own.begin = begin + 1;
+        own.end = end;
+        pthread_mutex_unlock(&own.lock);
+        return true;
+    }
+}
+
+}
@@ -0,0 +1,88 @@
+#include "nidaq/waveform.h"
+#include "nidaq/kernels.h"
+
+#include "ros/ros.h"
+#include <stdlib.h>
+
+namespace nidaq {
+
+// the whole field must be a number
+static bool parseNumber(const std::string& field, double* value)
+{
+    char *end;
+    *value = strtod(field.c_str(), &end);
+    return !field.empty() && end == field.c_str() + field.size();
+}
+
+bool parseWaveform(const std::string& text, WaveformSpec* spec)
+{
+    std::string fields[5];      // one more than a spec has, to catch extras
+    int count = 0;
+    size_t start = 0;
+    while(count < 5){
+        size_t end = text.find(':', start);
+        fields[count++] = text.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        if(end == std::string::npos)
+            break;
+        start = end + 1;
+    }
+
+    double amplitude = 0, phase = 0, cycles = 1.0;
+    if(fields[0] == "sine")
+        spec->shape = WaveformSpec::SINE;
+    else if(fields[0] == "cosine")
+        spec->shape = WaveformSpec::COSINE;
+    else if(fields[0] == "dc")
+        spec->shape = WaveformSpec::DC;
+    else
+        count = 0;
+    if(count < 2 || count > 4 || !parseNumber(fields[1], &amplitude) ||
+       (count > 2 && !parseNumber(fields[2], &phase)) ||
+       (count > 3 && (!parseNumber(fields[3], &cycles) || cycles <= 0))){
+        ROS_ERROR("Bad waveform '%s', expected sine|cosine|dc:amplitude[:phase_deg[:cycles]]", text.c_str());
+        return false;
+    }
+    spec->amplitude = amplitude;
+    spec->phase = phase*NIDAQ_PI/180.0;
+    spec->cycles = cycles;
+    return true;
+}
+
+void fillWaveform(const WaveformSpec& spec, double* out, uint32_t n)
+{
+    if(spec.shape == WaveformSpec::DC){
+        for(uint32_t i = 0; i < n; i++)
+            out[i] = spec.amplitude;
+        return;
+    }
+    double phase = spec.phase + (spec.shape == WaveformSpec::COSINE ? NIDAQ_PI/2 : 0.0);
+    double step = spec.cycles*2.0*NIDAQ_PI/(double)n;
+    for(uint32_t i = 0; i < n; i++)
+        out[i] = spec.amplitude*sin(phase + (double)i*step);
+}
+
+uint64_t waveformHash(const double* data, uint32_t n)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint64_t hash = 14695981039346656037ULL;
+    for(size_t i = 0; i < (size_t)n*sizeof(double); i++){
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void describeWaveform(const WaveformSpec& spec, double rate, const double* data, uint32_t n, waveformDescriptor* msg)
+{
+    static const char *shapes[] = { "sine", "cosine", "dc" };
+
+    msg->shape = shapes[spec.shape];
+    msg->amplitude = spec.amplitude;
+    msg->phase = spec.phase;
+    msg->frequency = spec.shape == WaveformSpec::DC || n == 0 ? 0.0 : rate*spec.cycles/n;
+    msg->rate = rate;
+    msg->buffer_length = n;
+    msg->buffer_hash = waveformHash(data, n);
+}
+
+}
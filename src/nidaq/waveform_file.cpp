@@ -0,0 +1,110 @@
+#include "nidaq/waveform_file.h"
+
+#include "ros/ros.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nidaq {
+
+WaveformFile::WaveformFile()
+    : map_(NULL), mapped_(0), scanBytes_(0)
+{
+    memset(&header_, 0, sizeof(header_));
+}
+
+WaveformFile::~WaveformFile()
+{
+    close();
+}
+
+bool WaveformFile::open(const std::string& path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        ROS_ERROR("Cannot open waveform %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(WaveformFileHeader) ||
+       pread(fd, &header_, sizeof(header_), 0) != (ssize_t)sizeof(header_) ||
+       memcmp(header_.magic, NIDAQ_WAVE_MAGIC, 8) != 0){
+        ROS_ERROR("%s is not a waveform file", path.c_str());
+        ::close(fd);
+        return false;
+    }
+
+    size_t sampleBytes = header_.format == WAVE_INT16 ? sizeof(int16_t) : sizeof(double);
+    scanBytes_ = sampleBytes*header_.channels;
+    if((header_.format != WAVE_FLOAT64 && header_.format != WAVE_INT16) || header_.channels == 0 ||
+       header_.scans == 0 || header_.dataOffset + header_.scans*scanBytes_ > (uint64_t)st.st_size){
+        ROS_ERROR("%s: bad header (format %u, %u channels, %llu scans) or file too short", path.c_str(),
+            header_.format, header_.channels, (unsigned long long)header_.scans);
+        ::close(fd);
+        return false;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED){
+        ROS_ERROR("Cannot map %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    map_ = (const uint8_t *)map;
+    mapped_ = st.st_size;
+    return true;
+}
+
+void WaveformFile::close()
+{
+    if(map_ == NULL)
+        return;
+    munmap((void *)map_, mapped_);
+    map_ = NULL;
+}
+
+void WaveformFile::read(uint64_t first, uint32_t count, double* out) const
+{
+    const uint8_t *src = map_ + header_.dataOffset + first*scanBytes_;
+    size_t n = (size_t)count*header_.channels;
+    if(header_.format == WAVE_FLOAT64){
+        memcpy(out, src, n*sizeof(double));
+        return;
+    }
+    const int16_t *raw = (const int16_t *)src;
+    for(size_t i = 0; i < n; i++)
+        out[i] = raw[i]*header_.scale + header_.offset;
+}
+
+void WaveformFile::advise(uint64_t first, uint64_t count, int advice, bool inward) const
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t begin = header_.dataOffset + first*scanBytes_;
+    size_t end = begin + count*scanBytes_;
+    if(end > mapped_)
+        end = mapped_;
+    // dropping pages must not touch a partial page still in use, loading may overshoot
+    begin = inward ? (begin + page - 1)/page*page : begin/page*page;
+    end = inward ? end/page*page : (end + page - 1)/page*page;
+    if(end > mapped_ && !inward)
+        end = mapped_;
+    if(end > begin)
+        madvise((void *)(map_ + begin), end - begin, advice);
+}
+
+void WaveformFile::prefetch(uint64_t first, uint64_t count) const
+{
+    advise(first, count, MADV_WILLNEED, false);
+}
+
+void WaveformFile::release(uint64_t first, uint64_t count) const
+{
+    advise(first, count, MADV_DONTNEED, true);
+}
+
+}
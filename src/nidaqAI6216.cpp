@@ -1,6 +1,8 @@
 #include "ros/ros.h"
 #include "ros/console.h"
 #include "nidaq/analogInput.h"
+#include "nidaq/sample_clock.h"
+#include "nidaq/kernels.h"
 #include "NIDAQmxBase.h"
 #include <stdio.h>
 #include <time.h>
@@ -39,10 +41,14 @@ int main (int argc, char **argv){
 	//Data read parameters
 	#define		bufferSize (uInt32)16
 	float64		data[bufferSize];
-	int32		pointsToRead = bufferSize;
+	int32		pointsToRead = samplesPerChan;	//scans, per channel
 	int32		pointsRead;
 	float64 	timeout = 1.0;
-	int32 		totalRead = 0;
+	uInt64 		totalRead = 0;
+	uInt32		avail;
+
+	//Sample timestamps, from the sample index and the fitted board clock
+	nidaq::SampleClock sampleClock(nidaq::boardSampleRate(sampleRate));
 
 	ROS_INFO("NIDAQmx Base node started");	
 	DAQmxErrChk(DAQmxBaseCreateTask("", &taskHandle));
@@ -52,28 +58,19 @@ int main (int argc, char **argv){
         
 	while(ok()){
            	DAQmxErrChk(DAQmxBaseReadAnalogF64(taskHandle, pointsToRead, timeout, DAQmx_Val_GroupByScanNumber, data, bufferSize, &pointsRead, NULL)); 
+		DAQmxErrChk(DAQmxBaseGetReadAttribute(taskHandle, DAQmx_Read_AvailSampPerChan, &avail));
+		sampleClock.update(totalRead + pointsRead + avail, Time::now());
+
 		nidaq::analogInput msg;
-		msg.header.stamp = Time::now();
+		msg.header.stamp = sampleClock.stamp(totalRead);
+		msg.sample_index = totalRead;
+		msg.acquisition_time = msg.header.stamp;
 
-		msg.a0 = data[0];
-		msg.a1 = data[1];
-		msg.a2 = data[2];
-		msg.a3 = data[3];
-		msg.a4 = data[4];
-		msg.a5 = data[5];
-		msg.a6 = data[6];
-		msg.a7 = data[7];
-		msg.a8 = data[8];
-		msg.a9 = data[9];
-		msg.a10 = data[10];
-		msg.a11 = data[11];
-		msg.a12 = data[12];
-		msg.a13 = data[13];
-		msg.a14 = data[14];
-		msg.a15 = data[15];
+		nidaq::packScan(data, &msg);
 
 		totalRead += pointsRead;
 		
+		msg.publish_time = Time::now();
 		nidaq_pub.publish(msg);
 		spinOnce();
 		loop_rate.sleep();
@@ -1,22 +1,130 @@
 #include "ros/ros.h"
 #include "ros/console.h"
 #include "nidaq/analogInput.h"
+#include "nidaq/analogInputBlock.h"
+#include "nidaq/kernels.h"
+#include "nidaq/simd_kernels.h"
+#include "nidaq/shape_kernels.h"
+#include "nidaq/sample_clock.h"
+#include "nidaq/daq_recovery.h"
+#include "nidaq/daqDiagnostics.h"
+#include "nidaq/shm_ring.h"
+#include "nidaq/shmBlock.h"
+#include "nidaq/channel_filter.h"
+#include "nidaq/channels.h"
+#include "nidaq/message_pool.h"
+#include "nidaq/alloc_guard.h"
 #include "NIDAQmxBase.h"
+#include <std_msgs/Float64.h>
 #include <stdio.h>
 #include <time.h>
+#include <map>
+#include <vector>
 
 #define DAQmxErrChk(functionCall) { if( DAQmxFailed(error=(functionCall)) ) { goto Error; } }
 
 using namespace ros;
 
+/*********************************************************************
+*    roscpp allocates while serializing and spinning. Those calls stay
+*    under the allocation guard but count as external, so roscpp's
+*    allocations are tallied apart from ours; everything else in the
+*    loop is expected not to allocate at all once warmed up.
+*********************************************************************/
+template <class M>
+static void publish(const Publisher& pub, const M& msg)
+{
+	nidaq::AllocGuardExternal external;
+	pub.publish(msg);
+}
+
+static void spinExternal()
+{
+	nidaq::AllocGuardExternal external;
+	spinOnce();
+}
+
+/*********************************************************************
+*    Picks channels out of the scan-major block into msg, scan-major,
+*    with the stamps of the full block.
+*********************************************************************/
+static void fanOut(const nidaq::analogInputBlock& block, const float64* data, int channels, const int* picks, int count, nidaq::analogInputBlock* msg)
+{
+	msg->header = block.header;
+	msg->channels = count;
+	msg->scans = block.scans;
+	msg->sample_period = block.sample_period;
+	msg->gap_samples = block.gap_samples;
+	msg->sample_index = block.sample_index;
+	msg->acquisition_time = block.acquisition_time;
+	msg->layout = nidaq::analogInputBlock::SCAN_MAJOR;
+	msg->data.resize(block.scans*count);
+	nidaq::gatherChannels(data, block.scans, channels, picks, count, &msg->data[0]);
+}
+
 int main (int argc, char **argv){
-	const double common_sampling_rate = 5;	//10.0
         init(argc, argv, "nidaqAnalog6221");
 
         NodeHandle n;
+        NodeHandle pn("~");
 
         Publisher nidaq_pub = n.advertise <nidaq::analogInput> ("nidaqAnalog6221", 1000);	//0
-        Rate loop_rate(common_sampling_rate);
+        Publisher block_pub = n.advertise <nidaq::analogInputBlock> ("nidaqAnalog6221/block", 10);
+        Publisher skew_pub = n.advertise <std_msgs::Float64> ("nidaqAnalog6221/clock_skew", 10);
+        Publisher diag_pub = n.advertise <nidaq::daqDiagnostics> ("nidaqAnalog6221/diagnostics", 10);
+
+	double		common_sampling_rate;	//10.0
+	int		blockSize;
+	bool		channelMajor;
+	pn.param("rate", common_sampling_rate, 5.0);
+	pn.param("block_size", blockSize, 1);	//scans per read
+	pn.param("channel_major", channelMajor, false);	//block layout
+	if(blockSize < 1)
+		blockSize = 1;
+
+	//Same-host consumers: blocks go to a shared-memory ring, only metadata on the topic
+	std::string	shmName;
+	int		shmSlots, shmMode;
+	pn.param("shm_ring", shmName, std::string(""));
+	pn.param("shm_slots", shmSlots, 64);
+	pn.param("shm_mode", shmMode, 0660);	//owner and group only, by default
+	nidaq::ShmRingWriter shmRing;
+	nidaq::shmBlock	shmMsg;
+	Publisher	shm_pub;
+	uint64_t	shmSeq;
+
+	//Per-channel processing (~process/...), channels split over a thread pool
+	nidaq::FilterConfig filterConfig;
+	nidaq::ChannelFilter channelFilter;
+	nidaq::analogInputBlockPtr filtered;
+	Publisher	filtered_pub;
+	nidaq::loadFilterConfig(pn, &filterConfig);
+
+	//Per-channel and per-group topics, like everything else only built while subscribed
+	bool		channelTopics;
+	std::map<std::string, std::string> groupSpecs;	//name -> "0:3,7"
+	std::vector<Publisher> channel_pubs, group_pubs;
+	std::vector<std::vector<int> > groupChannels;
+	nidaq::analogInputBlockPtr partial;
+	char		topicName[64];
+	bool		wantScan, wantBlock, wantFiltered, wantPartial;
+	bool		filterIdle = true;
+	pn.param("channel_topics", channelTopics, false);
+	pn.getParam("channel_groups", groupSpecs);
+
+	//Preallocated messages, recycled once roscpp lets go of them
+	int		poolSize, guardWarmup;
+	pn.param("pool_size", poolSize, 4);
+	pn.param("alloc_guard_warmup", guardWarmup, 1000);	//loops before the guard is armed
+	nidaq::MessagePool<nidaq::analogInputBlock> blockPool(poolSize);
+	nidaq::MessagePool<nidaq::analogInput> scanPool(poolSize);
+	nidaq::MessagePool<nidaq::analogInputBlock> fanPool(poolSize);	//per-channel, group and filtered topics
+	nidaq::analogInputBlockPtr blockMsg;
+	nidaq::analogInputPtr scanMsg;
+	uInt64		loops = 0;
+	uInt64		guardReported = 0;
+	uInt64		externalReported = 0;
+	bool		guardArmed = false;
 
 	// Task parameters
 	int32		error = 0;
@@ -35,52 +143,249 @@ int main (int argc, char **argv){
 	char		clockSource[] = "OnboardClock";
 	uInt64		samplesPerChan = 1;	//1
 	float64		sampleRate = common_sampling_rate;
+	uInt32		inputBuffer = blockSize*10 > 2000 ? blockSize*10 : 2000;
 
 	//Data read parameters
-	#define		bufferSize (uInt32)16		//16
-	float64		data[bufferSize];
-	int32		pointsToRead = bufferSize;
+	#define		numChannels 16
+	std::vector<float64> data(numChannels*blockSize);
+	int32		pointsToRead = blockSize;	//scans, per channel
 	int32		pointsRead;
-	float64 	timeout = 1.0;
-	int32 		totalRead = 0;
+	float64 	timeout = 1.0 + blockSize/sampleRate;
+	uInt64 		totalRead = 0;
+	uInt32		avail;
+
+	//Sample timestamps, from the sample index and the fitted board clock
+	nidaq::SampleClock sampleClock(nidaq::boardSampleRate(sampleRate));
+	nidaq::analogInputBlock block;
+	std_msgs::Float64 skew;
+	block.channels = numChannels;
+	block.layout = channelMajor ? nidaq::analogInputBlock::CHANNEL_MAJOR : nidaq::analogInputBlock::SCAN_MAJOR;
+	//full channel-major blocks of a common shape go through the compile-time specialized transpose
+	nidaq::BlockKernelFn blockKernel = channelMajor ? nidaq::deinterleaveFor(numChannels, blockSize) : NULL;
+	float		*blockOut;
+	blockPool.reserve(&nidaq::analogInputBlock::data, numChannels*blockSize);
+	fanPool.reserve(&nidaq::analogInputBlock::data, numChannels*blockSize);
+	if(!shmName.empty() && shmRing.open(shmName, shmSlots, numChannels, blockSize, shmMode)){
+		shm_pub = n.advertise <nidaq::shmBlock> ("nidaqAnalog6221/shm", 100);
+		shmMsg.ring_name = shmName;
+		shmMsg.channels = numChannels;
+	}
+	if(!channelFilter.configure(filterConfig, numChannels, sampleRate))
+		return 1;
+	if(channelFilter.enabled()){
+		filtered_pub = n.advertise <nidaq::analogInputBlock> ("nidaqAnalog6221/filtered", 10);
+	}
+	if(channelTopics){
+		for(i = 0; i < numChannels; i++){
+			snprintf(topicName, sizeof(topicName), "nidaqAnalog6221/ai%d", (int)i);
+			channel_pubs.push_back(n.advertise <nidaq::analogInputBlock> (topicName, 10));
+		}
+	}
+	for(std::map<std::string, std::string>::const_iterator g = groupSpecs.begin(); g != groupSpecs.end(); ++g){
+		std::vector<int> picks;
+		if(!nidaq::parseChannelIndices(g->second, numChannels, &picks)){
+			ROS_ERROR("~channel_groups/%s: bad channel list '%s'", g->first.c_str(), g->second.c_str());
+			return 1;
+		}
+		groupChannels.push_back(picks);
+		group_pubs.push_back(n.advertise <nidaq::analogInputBlock> ("nidaqAnalog6221/group/" + g->first, 10));
+	}
+
+	//Overrun recovery
+	nidaq::RecoveryStats recovery;
+	nidaq::daqDiagnostics diagnostics;
+	uInt64		pendingGap = 0;	//scans lost, reported with the next block
+	Time		resumed, lastReport;
+	nidaq::resetRecoveryStats(&recovery);
 
-	ROS_INFO("NIDAQmx Base node started");	
+	ROS_INFO("NIDAQmx Base node started (%s kernels)", nidaq::simdLevel());
 	DAQmxErrChk(DAQmxBaseCreateTask("", &taskHandle));
 	DAQmxErrChk(DAQmxBaseCreateAIVoltageChan(taskHandle, chan, "", DAQmx_Val_RSE, min, max, DAQmx_Val_Volts, NULL));
 	DAQmxErrChk(DAQmxBaseCfgSampClkTiming(taskHandle, clockSource, sampleRate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, samplesPerChan));
-	DAQmxErrChk (DAQmxBaseCfgInputBuffer(taskHandle,2000));	//wasnt here
-	DAQmxErrChk(DAQmxBaseStartTask(taskHandle));	
-        
+	DAQmxErrChk (DAQmxBaseCfgInputBuffer(taskHandle,inputBuffer));	//wasnt here
+	DAQmxErrChk(DAQmxBaseStartTask(taskHandle));
+	lastReport = Time::now();
+
 	while(ok()){
-           	DAQmxErrChk(DAQmxBaseReadAnalogF64(taskHandle, pointsToRead, timeout, DAQmx_Val_GroupByScanNumber, data, bufferSize, &pointsRead, NULL)); 
-		nidaq::analogInput msg;
-		msg.header.stamp = Time::now();
-
-		msg.a0 = data[0];
-		msg.a1 = data[1];
-		msg.a2 = data[2];
-		msg.a3 = data[3];
-		msg.a4 = data[4];
-		msg.a5 = data[5];
-		msg.a6 = data[6];
-		msg.a7 = data[7];
-		msg.a8 = data[8];
-		msg.a9 = data[9];
-		msg.a10 = data[10];
-		msg.a11 = data[11];
-		msg.a12 = data[12];
-		msg.a13 = data[13];
-		msg.a14 = data[14];
-		msg.a15 = data[15];
+		if(++loops == (uInt64)guardWarmup && nidaq::allocGuardActive()){
+			ROS_INFO("alloc guard armed after %d loops", guardWarmup);
+			nidaq::allocGuardArm();
+			guardArmed = true;
+		}
+           	error = DAQmxBaseReadAnalogF64(taskHandle, pointsToRead, timeout, DAQmx_Val_GroupByScanNumber, &data[0], data.size(), &pointsRead, NULL);
+		if(DAQmxFailed(error)){
+			nidaq::AllocGuardPause pause;	//recovery is not the steady state
+			if(!nidaq::recoverTask(taskHandle, error, &recovery))
+				goto Error;
+			if(nidaq::classifyDaqError(error) == nidaq::DAQ_OVERRUN){
+				//skip the sample index over the lost scans
+				resumed = Time::now();
+				uInt64 gap = (uInt64)((resumed - sampleClock.stamp(totalRead)).toSec()*sampleRate + 0.5);
+				totalRead += gap;
+				pendingGap += gap;
+				recovery.gapSamples += gap;
+				sampleClock.reset(totalRead, resumed);
+			}
+			error = 0;
+			continue;
+		}
+		DAQmxErrChk(DAQmxBaseGetReadAttribute(taskHandle, DAQmx_Read_AvailSampPerChan, &avail));
+		sampleClock.update(totalRead + pointsRead + avail, Time::now());
+		if(pointsRead <= 0)
+			continue;
+
+		//who listens decides what gets built; with nobody, only the read is left
+		wantScan = nidaq_pub.getNumSubscribers() > 0;
+		wantBlock = block_pub.getNumSubscribers() > 0;
+		wantFiltered = channelFilter.enabled() && filtered_pub.getNumSubscribers() > 0;
+		wantPartial = false;
+		for(i = 0; i < (int32)channel_pubs.size() && !wantPartial; i++)
+			wantPartial = channel_pubs[i].getNumSubscribers() > 0;
+		for(i = 0; i < (int32)group_pubs.size() && !wantPartial; i++)
+			wantPartial = group_pubs[i].getNumSubscribers() > 0;
+		if(!shmRing.isOpen() && !wantScan && !wantBlock && !wantFiltered && !wantPartial && skew_pub.getNumSubscribers() == 0){
+			totalRead += pointsRead;	//pendingGap waits for the next message
+			filterIdle = true;
+			if((Time::now() - lastReport).toSec() >= 1.0){
+				nidaq::fillDiagnostics(recovery, &diagnostics);
+				publish(diag_pub, diagnostics);
+				lastReport = Time::now();
+			}
+			spinExternal();
+			continue;
+		}
+
+		block.header.stamp = sampleClock.stamp(totalRead);
+		block.scans = pointsRead;
+		block.gap_samples = pendingGap;
+		block.sample_period = sampleClock.period();
+		block.sample_index = totalRead;
+		block.acquisition_time = block.header.stamp;
+		if(shmRing.isOpen() || wantBlock){
+			if(shmRing.isOpen()){
+				blockOut = shmRing.begin(&shmSeq);
+			}else{
+				blockMsg = blockPool.acquire();
+				blockMsg->header = block.header;
+				blockMsg->channels = block.channels;
+				blockMsg->scans = block.scans;
+				blockMsg->sample_period = block.sample_period;
+				blockMsg->gap_samples = block.gap_samples;
+				blockMsg->sample_index = block.sample_index;
+				blockMsg->acquisition_time = block.acquisition_time;
+				blockMsg->layout = block.layout;
+				blockMsg->data.resize(pointsRead*numChannels);
+				blockOut = &blockMsg->data[0];
+			}
+			if(!channelMajor)
+				nidaq::narrowF64(&data[0], blockOut, pointsRead*numChannels);
+			else if(blockKernel != NULL && pointsRead == blockSize)
+				blockKernel(&data[0], blockOut);
+			else
+				nidaq::deinterleave(&data[0], pointsRead, numChannels, blockOut);
+		}
+
+		if(shmRing.isOpen()){
+			shmRing.commit(pointsRead, block.header.stamp.toNSec(), block.sample_period, pendingGap, block.layout);
+
+			shmMsg.header = block.header;
+			shmMsg.block_seq = shmSeq;
+			shmMsg.slot = shmRing.slotOf(shmSeq);
+			shmMsg.scans = pointsRead;
+			shmMsg.sample_period = block.sample_period;
+			shmMsg.gap_samples = pendingGap;
+			shmMsg.layout = block.layout;
+			if(shm_pub.getNumSubscribers() > 0)
+				publish(shm_pub, shmMsg);
+		}else if(wantBlock){
+			blockMsg->publish_time = Time::now();
+			publish(block_pub, blockMsg);
+		}
 
+		//single channels and channel groups, scan-major
+		for(i = 0; i < (int32)channel_pubs.size(); i++){
+			if(channel_pubs[i].getNumSubscribers() == 0)
+				continue;
+			int pick = i;
+			partial = fanPool.acquire();
+			fanOut(block, &data[0], numChannels, &pick, 1, partial.get());
+			partial->publish_time = Time::now();
+			publish(channel_pubs[i], partial);
+			partial.reset();	//back to the pool once roscpp is done with it
+		}
+		for(i = 0; i < (int32)group_pubs.size(); i++){
+			if(group_pubs[i].getNumSubscribers() == 0)
+				continue;
+			partial = fanPool.acquire();
+			fanOut(block, &data[0], numChannels, &groupChannels[i][0], groupChannels[i].size(), partial.get());
+			partial->publish_time = Time::now();
+			publish(group_pubs[i], partial);
+			partial.reset();
+		}
+
+		if(wantFiltered){
+			if(pendingGap > 0 || filterIdle)
+				channelFilter.reset();	//the filter state is from before the gap
+			filterIdle = false;
+			filtered = fanPool.acquire();
+			filtered->header = block.header;
+			filtered->channels = numChannels;
+			filtered->layout = nidaq::analogInputBlock::CHANNEL_MAJOR;
+			filtered->scans = pointsRead;
+			filtered->sample_period = block.sample_period;
+			filtered->gap_samples = pendingGap;
+			filtered->sample_index = block.sample_index;
+			filtered->acquisition_time = block.acquisition_time;
+			filtered->data.resize(pointsRead*numChannels);
+			channelFilter.process(&data[0], pointsRead, &filtered->data[0]);
+			filtered->publish_time = Time::now();
+			publish(filtered_pub, filtered);
+			filtered.reset();
+		}else{
+			filterIdle = true;
+		}
+
+		//newest scan of the block on the per-scan topic
+		if(wantScan){
+			scanMsg = scanPool.acquire();
+			scanMsg->header.stamp = sampleClock.stamp(totalRead + pointsRead - 1);
+			scanMsg->gap_samples = pendingGap;
+			scanMsg->sample_index = totalRead + pointsRead - 1;
+			scanMsg->acquisition_time = scanMsg->header.stamp;
+			nidaq::packScan(&data[(pointsRead - 1)*numChannels], scanMsg.get());
+			scanMsg->publish_time = Time::now();
+			publish(nidaq_pub, scanMsg);
+		}
+		pendingGap = 0;
 		totalRead += pointsRead;
-		
-		nidaq_pub.publish(msg);
-		spinOnce();
-		loop_rate.sleep();
+
+		if(skew_pub.getNumSubscribers() > 0){
+			skew.data = sampleClock.skewPpm();
+			publish(skew_pub, skew);
+		}
+		if((Time::now() - lastReport).toSec() >= 1.0){
+			nidaq::fillDiagnostics(recovery, &diagnostics);
+			publish(diag_pub, diagnostics);
+			lastReport = Time::now();
+			if(nidaq::allocGuardCount() + blockPool.grown() + scanPool.grown() + fanPool.grown() > guardReported){
+				nidaq::AllocGuardPause pause;
+				guardReported = nidaq::allocGuardCount() + blockPool.grown() + scanPool.grown() + fanPool.grown();
+				ROS_WARN("alloc guard: %llu allocations in the steady-state loop, message pools grew %llu times",
+					(unsigned long long)nidaq::allocGuardCount(), (unsigned long long)(blockPool.grown() + scanPool.grown() + fanPool.grown()));
+			}
+			if(guardArmed){
+				nidaq::AllocGuardPause pause;
+				ROS_DEBUG("alloc guard: roscpp made %llu allocations in publish and spinOnce this second",
+					(unsigned long long)(nidaq::allocGuardExternalCount() - externalReported));
+				externalReported = nidaq::allocGuardExternalCount();
+			}
+		}
+		spinExternal();
 	}
 
 	Error:
+		if (guardArmed)
+			nidaq::allocGuardDisarm();
 		if (DAQmxFailed(error))
 			DAQmxBaseGetExtendedErrorInfo(errBuff, 2048);
 		if (taskHandle != 0)
@@ -0,0 +1,212 @@
+/*********************************************************************
+*
+* nidaqSync:
+*    Synchronized acquisition on Dev1 (6221) and Dev2 (6216).
+*
+* Description:
+*    Both boards acquire ai0:15 on one shared sample clock, generated
+*    as a pulse train by a counter on Dev1. The two AI tasks are armed
+*    first and the counter is started last, so the first clock edge
+*    is the common start trigger and scan k on Dev1 is taken on the
+*    same edge as scan k on Dev2. Each block is published as one
+*    32-channel analogInputBlock (Dev1 channels first).
+*
+* I/O Connections Overview:
+*    The counter output (Dev1/ctr0 -> PFI12 by default) must reach the
+*    sample clock input of both boards: Dev1 uses PFI12 directly,
+*    Dev2 needs a wire from Dev1 PFI12 to Dev2 PFI0 (or whatever
+*    ~dev2_clock names). Both boards need a common ground.
+*
+* Skew:
+*    With a shared clock the sample counters of both tasks must move
+*    in lockstep. After every block the scans delivered so far plus
+*    those still waiting in each buffer are compared; any difference
+*    is clock skew (a missed or extra edge). The two buffers are
+*    queried one after the other, so edges that arrive in between are
+*    counted on Dev2 only: the skew reported is the one closest to zero
+*    that the query window allows. It is published on nidaqSync/skew in
+*    seconds and warned about when it exceeds ~max_skew_samples.
+*
+*********************************************************************/
+
+#include <NIDAQmxBase.h>
+#include "ros/ros.h"
+#include "ros/console.h"
+#include "nidaq/analogInputBlock.h"
+#include "nidaq/channels.h"
+#include "nidaq/sample_clock.h"
+#include <std_msgs/Float64.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <signal.h>
+#include <vector>
+
+#define DAQmxErrChk(functionCall) { if( DAQmxFailed(error=(functionCall)) ) { goto Error; } }
+
+using namespace ros;
+
+static TaskHandle  taskHandleClk = 0;
+static TaskHandle  taskHandleAI1 = 0;
+static TaskHandle  taskHandleAI2 = 0;
+
+void my_handler(int s){
+    printf("Caught signal %d\n",s);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    init(argc, argv, "nidaqSync");
+    NodeHandle n;
+    NodeHandle pn("~");
+
+    Publisher nidaq_pub = n.advertise <nidaq::analogInputBlock> ("nidaqSync", 10);
+    Publisher skew_pub = n.advertise <std_msgs::Float64> ("nidaqSync/skew", 10);
+    Publisher clock_skew_pub = n.advertise <std_msgs::Float64> ("nidaqSync/clock_skew", 10);
+
+    // Task parameters
+    int32       error = 0;
+    char        errBuff[2048]={'\0'};
+
+    // Channel parameters
+    std::string chanAI1, chanAI2, chanClk, clockAI1, clockAI2;
+    pn.param("dev1_channels", chanAI1, std::string("Dev1/ai0:15"));
+    pn.param("dev2_channels", chanAI2, std::string("Dev2/ai0:15"));
+    pn.param("counter", chanClk, std::string("Dev1/ctr0"));
+    pn.param("dev1_clock", clockAI1, std::string("/Dev1/PFI12"));
+    pn.param("dev2_clock", clockAI2, std::string("/Dev2/PFI0"));
+    float64     maxAI = 10.0;
+    float64     minAI = -10.0;
+    int         nChan1 = nidaq::countChannels(chanAI1);
+    int         nChan2 = nidaq::countChannels(chanAI2);
+    int         nChan = nChan1 + nChan2;
+
+    // Timing parameters
+    double      rate;
+    int         blockSize, maxSkewSamples;
+    pn.param("rate", rate, 1000.0);
+    pn.param("block_size", blockSize, 100);
+    pn.param("max_skew_samples", maxSkewSamples, 1);
+    uInt64      inputBuffer = (uInt64)blockSize*100;
+
+    // Data read parameters
+    std::vector<float64> data1(blockSize*nChan1);
+    std::vector<float64> data2(blockSize*nChan2);
+    int32       pointsRead1, pointsRead2;
+    uInt32      avail1, avail2;
+    float64     timeout = 10.0;
+    uInt64      totalRead = 0;
+    uInt64      totalRead1 = 0, totalRead2 = 0;	//scans delivered per board
+    int64       buffered, windowSamples, skewSamples;
+    Time        queryStart;
+    uInt64      skewWarnings = 0;
+    nidaq::analogInputBlock msg;
+    std_msgs::Float64 skewMsg;
+    std_msgs::Float64 clockSkewMsg;
+    nidaq::SampleClock sampleClock(nidaq::boardSampleRate(rate));	//one clock drives both boards
+
+    if(nChan1 == 0 || nChan2 == 0 || blockSize <= 0){
+        ROS_ERROR("nidaqSync: bad channel list or block size");
+        return 1;
+    }
+
+    msg.channels = nChan;
+    msg.scans = blockSize;
+    msg.sample_period = 1.0/rate;
+    msg.data.reserve(blockSize*nChan);
+
+    ROS_INFO("NIDAQmx Base sync node started (%d + %d channels at %.0f S/s)", nChan1, nChan2, rate);
+    DAQmxErrChk (DAQmxBaseCreateTask("", &taskHandleClk));
+    DAQmxErrChk (DAQmxBaseCreateTask("", &taskHandleAI1));
+    DAQmxErrChk (DAQmxBaseCreateTask("", &taskHandleAI2));
+
+    // shared sample clock, 50% duty
+    DAQmxErrChk (DAQmxBaseCreateCOPulseChanFreq(taskHandleClk, chanClk.c_str(), "", DAQmx_Val_Hz, DAQmx_Val_Low, 0.0, rate, 0.5));
+    DAQmxErrChk (DAQmxBaseCfgImplicitTiming(taskHandleClk, DAQmx_Val_ContSamps, 1000));
+
+    DAQmxErrChk (DAQmxBaseCreateAIVoltageChan(taskHandleAI1, chanAI1.c_str(), "", DAQmx_Val_RSE, minAI, maxAI, DAQmx_Val_Volts, NULL));
+    DAQmxErrChk (DAQmxBaseCfgSampClkTiming(taskHandleAI1, clockAI1.c_str(), rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, inputBuffer));
+    DAQmxErrChk (DAQmxBaseCfgInputBuffer(taskHandleAI1, inputBuffer));
+
+    DAQmxErrChk (DAQmxBaseCreateAIVoltageChan(taskHandleAI2, chanAI2.c_str(), "", DAQmx_Val_RSE, minAI, maxAI, DAQmx_Val_Volts, NULL));
+    DAQmxErrChk (DAQmxBaseCfgSampClkTiming(taskHandleAI2, clockAI2.c_str(), rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, inputBuffer));
+    DAQmxErrChk (DAQmxBaseCfgInputBuffer(taskHandleAI2, inputBuffer));
+
+    // arm both AI tasks, then release the clock: its first edge starts both
+    DAQmxErrChk (DAQmxBaseStartTask(taskHandleAI1));
+    DAQmxErrChk (DAQmxBaseStartTask(taskHandleAI2));
+    DAQmxErrChk (DAQmxBaseStartTask(taskHandleClk));
+    ROS_INFO("NIDAQmx sync acquisition running");
+
+    signal(SIGINT, my_handler);
+    while(ok()) {
+        DAQmxErrChk (DAQmxBaseReadAnalogF64(taskHandleAI1, blockSize, timeout, DAQmx_Val_GroupByScanNumber, &data1[0], data1.size(), &pointsRead1, NULL));
+        DAQmxErrChk (DAQmxBaseReadAnalogF64(taskHandleAI2, blockSize, timeout, DAQmx_Val_GroupByScanNumber, &data2[0], data2.size(), &pointsRead2, NULL));
+        totalRead1 += pointsRead1;
+        totalRead2 += pointsRead2;
+        queryStart = Time::now();
+        DAQmxErrChk (DAQmxBaseGetReadAttribute(taskHandleAI1, DAQmx_Read_AvailSampPerChan, &avail1));
+        DAQmxErrChk (DAQmxBaseGetReadAttribute(taskHandleAI2, DAQmx_Read_AvailSampPerChan, &avail2));
+        windowSamples = (int64)ceil((Time::now() - queryStart).toSec()*rate);
+        sampleClock.update(totalRead1 + avail1, Time::now());	//Dev1's own count, whatever Dev2 returned
+
+        // delivered plus still buffered is each board's sample count. Edges
+        // between the two queries only reach avail2, so the true skew lies
+        // in [buffered, buffered + windowSamples]; take the point nearest 0
+        buffered = (int64)(totalRead1 + avail1) - (int64)(totalRead2 + avail2);
+        if(buffered > 0)
+            skewSamples = buffered;
+        else if(buffered + windowSamples < 0)
+            skewSamples = buffered + windowSamples;
+        else
+            skewSamples = 0;
+        skewMsg.data = skewSamples / rate;
+        skew_pub.publish(skewMsg);
+        if(llabs(skewSamples) > maxSkewSamples){
+            skewWarnings++;
+            ROS_WARN_THROTTLE(1.0, "nidaqSync: boards %lld samples apart (%llu blocks out of bound so far)", (long long)skewSamples, (unsigned long long)skewWarnings);
+        }
+
+        msg.header.stamp = sampleClock.stamp(totalRead);
+        msg.sample_period = sampleClock.period();
+        msg.sample_index = totalRead;
+        msg.acquisition_time = msg.header.stamp;
+        msg.scans = pointsRead1 < pointsRead2 ? pointsRead1 : pointsRead2;
+        msg.data.resize(msg.scans*nChan);
+        for(uInt32 s = 0; s < msg.scans; s++){
+            float *scan = &msg.data[s*nChan];
+            for(int c = 0; c < nChan1; c++)
+                scan[c] = data1[s*nChan1 + c];
+            for(int c = 0; c < nChan2; c++)
+                scan[nChan1 + c] = data2[s*nChan2 + c];
+        }
+        totalRead += msg.scans;
+
+        clockSkewMsg.data = sampleClock.skewPpm();
+
+        msg.publish_time = Time::now();
+        nidaq_pub.publish(msg);
+        clock_skew_pub.publish(clockSkewMsg);
+        spinOnce();
+    }
+
+Error:
+    if( DAQmxFailed(error) )
+        DAQmxBaseGetExtendedErrorInfo(errBuff,2048);
+    if( taskHandleClk != 0 ) {
+        DAQmxBaseStopTask(taskHandleClk);
+        DAQmxBaseClearTask(taskHandleClk);
+    }
+    if( taskHandleAI1 != 0 ) {
+        DAQmxBaseStopTask(taskHandleAI1);
+        DAQmxBaseClearTask(taskHandleAI1);
+    }
+    if( taskHandleAI2 != 0 ) {
+        DAQmxBaseStopTask(taskHandleAI2);
+        DAQmxBaseClearTask(taskHandleAI2);
+    }
+    if( DAQmxFailed(error) )
+        printf ("DAQmxBase Error %ld: %s\n", error, errBuff);
+    return 0;
+}
@@ -53,7 +53,9 @@
 #include <unistd.h>
 #include "ros/ros.h"
 #include "ros/console.h"
-#include "nidaq/analogOutput.h"
+#include "nidaq/waveform.h"
+#include "nidaq/waveformDescriptor.h"
+#include "nidaq/GetWaveform.h"
 #include "NIDAQmxBase.h"
 #include <signal.h>
 #include <stdlib.h>
@@ -61,7 +63,6 @@
 
 #define DAQmxErrChk(functionCall) { if( DAQmxFailed(error=(functionCall)) ) { goto Error; } }
 #define PI	3.1415926535
-#define NUM 	1000000
 
 using namespace ros;
 
@@ -69,23 +70,36 @@ static int gRunning = 0;
 
 static TaskHandle  taskHandle = 0;
 
+// what the board is generating, for get_waveform
+static nidaq::waveformDescriptor descriptor;
+static std::vector<float64> waveform;
+
 void my_handler(int s){
     printf("Caught signal %d\n",s);
     exit(1); 
 }
 
+static bool getWaveform(nidaq::GetWaveform::Request& req, nidaq::GetWaveform::Response& res)
+{
+    res.descriptor = descriptor;
+    res.data = waveform;
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
     const double common_sampling_rate = 200000.0;  //drastic freq change (/500) -> Hz
     init(argc, argv, "nidaqOutput6221");
 
     NodeHandle n;
+    NodeHandle pn("~");
 
-    Publisher nidaq_pub = n.advertise <nidaq::analogOutput> ("nidaqOutput6221", 0);
+    //the buffer is regenerated by the board; what it holds is published once, latched
+    Publisher waveform_pub = n.advertise <nidaq::waveformDescriptor> ("nidaqOutput6221/waveform", 1, true);
+    ServiceServer waveform_srv = n.advertiseService("nidaqOutput6221/get_waveform", getWaveform);
 
     // Task parameters
     int32       error = 0;
-    int32       i = 0;
     char        errBuff[2048]={'\0'};
     bool32      done = 0;
  
@@ -104,11 +118,18 @@ int main(int argc, char *argv[])
     float64     data[bufferSize];
     int32       pointsWritten;
     float64     timeout = 10;		//affects frequency a bit.
-    int32 	totalWritten = 0;	
+    std::string wave;
+    nidaq::WaveformSpec spec;
+    Rate        loop_rate(10);		//task checks, the board does the rest
 
-    for(;i<bufferSize; i++){	//basically, generates a sine wave with a number of "bufferSize" points on it and repeats it.
-        data[i] = 2.35*sin((double)i*2.0*PI/(double)bufferSize);
-    }
+    //basically, generates a sine wave with a number of "bufferSize" points on it and repeats it.
+    pn.param("waveform", wave, std::string("sine:2.35"));
+    if(!nidaq::parseWaveform(wave, &spec))
+        return 1;
+    nidaq::fillWaveform(spec, data, bufferSize);
+    waveform.assign(data, data + bufferSize);
+    nidaq::describeWaveform(spec, sampleRate, data, bufferSize, &descriptor);
+    descriptor.channel = chan;
 
 
     ROS_INFO("NIDAQmx Base Analog Output node started");	
@@ -119,27 +140,18 @@ int main(int argc, char *argv[])
     DAQmxErrChk (DAQmxBaseWriteAnalogF64(taskHandle,samplesPerChan,0,timeout,DAQmx_Val_GroupByChannel,data,&pointsWritten,NULL));
 
     DAQmxErrChk (DAQmxBaseStartTask(taskHandle));
+    descriptor.start_time = Time::now();
+    descriptor.header.stamp = descriptor.start_time;
+    waveform_pub.publish(descriptor);
+    ROS_INFO("AO %s: %s, %.1f Hz, %d samples at %.0f S/s", chan, wave.c_str(), descriptor.frequency, (int)bufferSize, sampleRate);
 
-    i = 0;
     gRunning = 1;	
     ROS_INFO("Loop will quit after pressing Ctrl+C");	
-    while(gRunning && !done) {
-	signal(SIGINT, my_handler);
-
+    signal(SIGINT, my_handler);
+    while(gRunning && !done && ok()) {
         DAQmxErrChk (DAQmxBaseIsTaskDone(taskHandle, &done));
-	if( !done )
-            usleep(NUM/common_sampling_rate);	//500 Hz <-> 10^6/x Hz (frequency of publishing)
-
-	nidaq::analogOutput msg;
-	msg.header.stamp = Time::now();
-
-	msg.o0 = data[i];
-	totalWritten += pointsWritten;	
-
-	nidaq_pub.publish(msg);
 	spinOnce();
-
-	i=(i + 1) % bufferSize;
+	loop_rate.sleep();
     }
 
 Error:
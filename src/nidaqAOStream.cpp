@@ -0,0 +1,237 @@
+/*********************************************************************
+*
+* nidaqAOStream:
+*    Streams a long waveform file to the analog outputs.
+*
+* Description:
+*    The file (see nidaq/waveform_file.h, written by
+*    scripts/write_waveform.py) is memory-mapped, not loaded. The AO
+*    task is continuous without regeneration: ~buffer_chunks chunks of
+*    ~chunk scans are written before the start, then one chunk per
+*    loop. The blocking write paces the loop to the board. While a
+*    chunk plays, the pages of the next ~prefetch_chunks are being read
+*    in and the pages already played are dropped, so memory use stays
+*    the same for a file of any length.
+*
+*    ~loop plays the file over and over, otherwise the last value is
+*    held and the node exits when the file is done. Publish a time in
+*    seconds on nidaqAOStream/seek to jump; it is heard after the
+*    ~buffer_chunks already queued. The position written so far is
+*    published on nidaqAOStream/position (seconds).
+*
+* I/O Connections Overview:
+*    ~channels lists one AO channel per file channel (default
+*    Dev1/ao0), in file order.
+*
+*********************************************************************/
+
+#include <NIDAQmxBase.h>
+#include "ros/ros.h"
+#include "ros/console.h"
+#include "nidaq/channels.h"
+#include "nidaq/waveform_file.h"
+#include "nidaq/daq_recovery.h"
+#include "nidaq/daqDiagnostics.h"
+#include <std_msgs/Float64.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <vector>
+
+#define DAQmxErrChk(functionCall) { if( DAQmxFailed(error=(functionCall)) ) { goto Error; } }
+
+using namespace ros;
+
+static TaskHandle  taskHandle = 0;
+static double      seekRequest = -1;   // seconds, from the seek topic
+
+void my_handler(int s){
+    printf("Caught signal %d\n",s);
+    exit(1);
+}
+
+void seekCallback(const std_msgs::Float64::ConstPtr& msg)
+{
+    seekRequest = msg->data;
+}
+
+/*********************************************************************
+*    Copies count scans from *pos on into out, wrapping to the start
+*    when looping. Without looping the last scan is repeated past the
+*    end and false is returned.
+*********************************************************************/
+static bool fillChunk(const nidaq::WaveformFile& file, uint64_t* pos, uint32_t count, bool loop, float64* out)
+{
+    uint32_t channels = file.channels();
+    uint32_t done = 0;
+
+    while(done < count){
+        if(*pos >= file.scans()){
+            if(!loop){
+                file.read(file.scans() - 1, 1, out + done*channels);
+                for(uint32_t s = done + 1; s < count; s++)
+                    for(uint32_t c = 0; c < channels; c++)
+                        out[s*channels + c] = out[done*channels + c];
+                return false;
+            }
+            *pos = 0;
+        }
+        uint64_t n = file.scans() - *pos;
+        if(n > count - done)
+            n = count - done;
+        file.read(*pos, n, out + done*channels);
+        file.release(*pos, n);
+        *pos += n;
+        done += n;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    init(argc, argv, "nidaqAOStream");
+    NodeHandle n;
+    NodeHandle pn("~");
+
+    Publisher position_pub = n.advertise <std_msgs::Float64> ("nidaqAOStream/position", 10);
+    Publisher diag_pub = n.advertise <nidaq::daqDiagnostics> ("nidaqAOStream/diagnostics", 10);
+    Subscriber seek_sub = n.subscribe("nidaqAOStream/seek", 10, seekCallback);
+
+    // Task parameters
+    int32       error = 0;
+    char        errBuff[2048]={'\0'};
+
+    // Waveform and channel parameters
+    std::string path, chan;
+    double      rate, startSec, minAO, maxAO;
+    int         chunk, bufferChunks, prefetchChunks;
+    bool        loop;
+    pn.param("file", path, std::string(""));
+    pn.param("channels", chan, std::string("Dev1/ao0"));
+    pn.param("rate", rate, 0.0);		//0: the file's rate
+    pn.param("chunk", chunk, 0);		//scans per write, 0: 50 ms
+    pn.param("buffer_chunks", bufferChunks, 4);
+    pn.param("prefetch_chunks", prefetchChunks, 8);
+    pn.param("loop", loop, true);
+    pn.param("start", startSec, 0.0);
+    pn.param("min", minAO, -10.0);
+    pn.param("max", maxAO, 10.0);
+
+    nidaq::WaveformFile file;
+    if(!file.open(path))
+        return 1;
+    if(nidaq::countChannels(chan) != (int)file.channels()){
+        ROS_ERROR("%s has %u channels, ~channels '%s' has %d", path.c_str(), file.channels(), chan.c_str(), nidaq::countChannels(chan));
+        return 1;
+    }
+    if(rate <= 0)
+        rate = file.header().sampleRate;
+    if(chunk <= 0)
+        chunk = (int)(rate/20) > 1 ? (int)(rate/20) : 1;
+    if(bufferChunks < 2)
+        bufferChunks = 2;
+
+    // Timing and data write parameters
+    uInt64      bufferScans = (uInt64)chunk*bufferChunks;
+    std::vector<float64> data(bufferScans*file.channels());
+    uint64_t    pos = (uint64_t)(startSec*rate);
+    uint64_t    written = 0;		//scans handed to the task
+    int32       pointsWritten;
+    int32       chunkWritten;		//scans of the current chunk already in the buffer
+    float64     timeout = 1.0 + 2.0*bufferScans/rate;
+    bool        more = true;
+    std_msgs::Float64 position;
+
+    // Underrun recovery
+    nidaq::RecoveryStats recovery;
+    nidaq::daqDiagnostics diagnostics;
+    Time        lastReport;
+    nidaq::resetRecoveryStats(&recovery);
+
+    if(pos >= file.scans())
+        pos = 0;
+    file.prefetch(pos, (uint64_t)chunk*(bufferChunks + prefetchChunks));
+
+    ROS_INFO("NIDAQmx Base AO stream: %s, %u channels, %llu scans (%.1f s) at %.0f S/s, chunks of %d",
+        path.c_str(), file.channels(), (unsigned long long)file.scans(), file.scans()/rate, rate, chunk);
+    DAQmxErrChk (DAQmxBaseCreateTask("", &taskHandle));
+    DAQmxErrChk (DAQmxBaseCreateAOVoltageChan(taskHandle, chan.c_str(), "", minAO, maxAO, DAQmx_Val_Volts, NULL));
+    DAQmxErrChk (DAQmxBaseCfgSampClkTiming(taskHandle, "OnboardClock", rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, bufferScans));
+    //new data only: running out is an underrun, not a replay of old samples
+    if(!nidaq::disableRegeneration(taskHandle))
+        goto Error;
+
+    // prefill the whole buffer, the first write sizes it
+    more = fillChunk(file, &pos, bufferScans, loop, &data[0]);
+    DAQmxErrChk (DAQmxBaseWriteAnalogF64(taskHandle, bufferScans, 0, timeout, DAQmx_Val_GroupByScanNumber, &data[0], &pointsWritten, NULL));
+    written += pointsWritten;
+    DAQmxErrChk (DAQmxBaseStartTask(taskHandle));
+    lastReport = Time::now();
+
+    signal(SIGINT, my_handler);
+    while(ok() && more) {
+        spinOnce();
+        if(seekRequest >= 0){
+            pos = (uint64_t)(seekRequest*rate);
+            if(pos >= file.scans())
+                pos = file.scans() - 1;
+            ROS_INFO("nidaqAOStream: seek to %.3f s", pos/rate);
+            seekRequest = -1;
+        }
+
+        file.prefetch(pos, (uint64_t)chunk*prefetchChunks);
+        more = fillChunk(file, &pos, chunk, loop, &data[0]);
+
+        error = DAQmxBaseWriteAnalogF64(taskHandle, chunk, 0, timeout, DAQmx_Val_GroupByScanNumber, &data[0], &pointsWritten, NULL);
+        chunkWritten = pointsWritten;
+        while(DAQmxFailed(error) && nidaq::classifyDaqError(error) == nidaq::DAQ_TIMEOUT && ok()){
+            //the buffer stayed full: nothing was lost, write the rest again
+            recovery.timeouts++;
+            error = DAQmxBaseWriteAnalogF64(taskHandle, chunk - chunkWritten, 0, timeout, DAQmx_Val_GroupByScanNumber,
+                                            &data[(size_t)chunkWritten*file.channels()], &pointsWritten, NULL);
+            chunkWritten += pointsWritten;
+        }
+        pointsWritten = chunkWritten;
+        if(DAQmxFailed(error)){
+            if(nidaq::classifyDaqError(error) == nidaq::DAQ_TIMEOUT)
+                break;		//shutting down
+            if(nidaq::classifyDaqError(error) != nidaq::DAQ_UNDERRUN)
+                goto Error;
+            //the buffer ran dry: refill it from here and start over
+            recovery.underruns++;
+            recovery.restarts++;
+            ROS_WARN("nidaqAOStream: output underrun (error %ld), restarting at %.3f s", (long)error, pos/rate);
+            DAQmxBaseStopTask(taskHandle);
+            more = fillChunk(file, &pos, bufferScans, loop, &data[0]);
+            DAQmxErrChk (DAQmxBaseWriteAnalogF64(taskHandle, bufferScans, 0, timeout, DAQmx_Val_GroupByScanNumber, &data[0], &pointsWritten, NULL));
+            DAQmxErrChk (DAQmxBaseStartTask(taskHandle));
+            error = 0;
+        }
+        written += pointsWritten;
+
+        position.data = pos/rate;
+        position_pub.publish(position);
+        if((Time::now() - lastReport).toSec() >= 1.0){
+            nidaq::fillDiagnostics(recovery, &diagnostics);
+            diag_pub.publish(diagnostics);
+            lastReport = Time::now();
+        }
+    }
+
+    // end of the file: let what is queued play out
+    if(ok())
+        usleep((useconds_t)(1e6*bufferScans/rate));
+    ROS_INFO("nidaqAOStream: %llu scans written", (unsigned long long)written);
+
+Error:
+    if( DAQmxFailed(error) )
+        DAQmxBaseGetExtendedErrorInfo(errBuff,2048);
+    if( taskHandle!=0 ) {
+        DAQmxBaseStopTask(taskHandle);
+        DAQmxBaseClearTask(taskHandle);
+    }
+    if( DAQmxFailed(error) )
+        printf ("DAQmxBase Error %ld: %s\n", error, errBuff);
+    return 0;
+}
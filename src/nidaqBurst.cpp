@@ -0,0 +1,237 @@
+/*********************************************************************
+*
+* nidaqBurst:
+*    Finite, full-speed captures on request.
+*
+* Description:
+*    Keeps one finite-samples AI task (DAQmx_Val_FiniteSamps) created,
+*    timed and, if asked, armed on a digital start trigger, so that a
+*    nidaqBurst/capture call only starts it, reads the whole burst and
+*    stops it again. The reply carries the burst as one scan-major
+*    float32 analogInputBlock, e.g. 100000 scans of ai0 at 250 kS/s:
+*
+*        rosservice call /nidaqBurst/capture "{channels: Dev1/ai0, rate: 250000, scans: 100000}"
+*        rosservice call /nidaqBurst/capture "{trigger: /Dev1/PFI0, timeout: 30}"
+*
+*    The task starts out from ~channels, ~rate, ~scans, ~min, ~max,
+*    ~trigger and ~falling. A request that changes them reconfigures
+*    the task once; only new channels or ranges rebuild it. The stamps
+*    are estimated back from the end of the read (header.stamp and
+*    acquisition_time: the first scan), sample_index counts the scans
+*    of all bursts so far.
+*
+* I/O Connections Overview:
+*    A start trigger goes to the PFI line named by ~trigger.
+*
+*********************************************************************/
+
+#include <NIDAQmxBase.h>
+#include "ros/ros.h"
+#include "ros/console.h"
+#include "nidaq/CaptureBurst.h"
+#include "nidaq/channels.h"
+#include "nidaq/simd_kernels.h"
+#include <signal.h>
+#include <stdio.h>
+#include <vector>
+
+using namespace ros;
+
+struct BurstConfig {
+    std::string channels;
+    double      rate;
+    uInt32      scans;
+    double      min, max;
+    std::string trigger;        // empty: none
+    bool        falling;
+};
+
+static TaskHandle   taskHandle = 0;
+static BurstConfig  current;
+static int          numChannels = 0;
+static bool         timed = false;          // current rate, scans and trigger are applied
+static double       defaultTimeout;
+static uInt64       totalScans = 0;
+static std::vector<float64> data;
+
+void my_handler(int s){
+    printf("Caught signal %d\n",s);
+    if(taskHandle != 0){
+        DAQmxBaseStopTask(taskHandle);
+        DAQmxBaseClearTask(taskHandle);
+    }
+    exit(1);
+}
+
+static std::string daqError(int32 error)
+{
+    char errBuff[2048] = { '\0' };
+    char line[2200];
+    DAQmxBaseGetExtendedErrorInfo(errBuff, sizeof(errBuff));
+    snprintf(line, sizeof(line), "DAQmxBase Error %ld: %s", (long)error, errBuff);
+    return line;
+}
+
+/*********************************************************************
+*    Brings the task to want, doing only what changed: new channels or
+*    ranges rebuild it, new rate or scans re-time it, a new trigger
+*    re-arms it.
+*********************************************************************/
+static bool applyConfig(const BurstConfig& want, std::string* message)
+{
+    int32 error = 0;
+    bool rebuild = taskHandle == 0 || want.channels != current.channels || want.min != current.min || want.max != current.max;
+    bool retime = rebuild || !timed || want.rate != current.rate || want.scans != current.scans;
+    bool retrigger = rebuild || !timed || want.trigger != current.trigger || (!want.trigger.empty() && want.falling != current.falling);
+
+    int channels = nidaq::countChannels(want.channels);
+    if(channels == 0 || want.rate <= 0 || want.scans < 2 || want.min >= want.max){
+        *message = "bad channel list, rate, scan count or range";
+        return false;
+    }
+
+    timed = false;
+    if(rebuild){
+        if(taskHandle != 0){
+            DAQmxBaseClearTask(taskHandle);
+            taskHandle = 0;
+        }
+        if(DAQmxFailed(error = DAQmxBaseCreateTask("", &taskHandle)) ||
+           DAQmxFailed(error = DAQmxBaseCreateAIVoltageChan(taskHandle, want.channels.c_str(), "", DAQmx_Val_RSE, want.min, want.max, DAQmx_Val_Volts, NULL))){
+            *message = daqError(error);
+            if(taskHandle != 0)
+                DAQmxBaseClearTask(taskHandle);
+            taskHandle = 0;
+            return false;
+        }
+        //the task has these channels now, whatever fails below: timed stays
+        //false, so the next request re-times and re-arms it
+        numChannels = channels;
+        current.channels = want.channels;
+        current.min = want.min;
+        current.max = want.max;
+    }
+    if(retime && DAQmxFailed(error = DAQmxBaseCfgSampClkTiming(taskHandle, "OnboardClock", want.rate, DAQmx_Val_Rising, DAQmx_Val_FiniteSamps, want.scans))){
+        *message = daqError(error);
+        return false;
+    }
+    if(retrigger){
+        if(want.trigger.empty())
+            error = DAQmxBaseDisableStartTrig(taskHandle);
+        else
+            error = DAQmxBaseCfgDigEdgeStartTrig(taskHandle, want.trigger.c_str(), want.falling ? DAQmx_Val_Falling : DAQmx_Val_Rising);
+        if(DAQmxFailed(error)){
+            *message = daqError(error);
+            return false;
+        }
+    }
+
+    data.resize((size_t)want.scans*numChannels);
+    current = want;
+    timed = true;
+    if(rebuild || retime || retrigger)
+        ROS_INFO("nidaqBurst: %s, %u scans at %.0f S/s, trigger %s", current.channels.c_str(), current.scans, current.rate,
+            current.trigger.empty() ? "none" : current.trigger.c_str());
+    return true;
+}
+
+static bool captureCallback(nidaq::CaptureBurst::Request& req, nidaq::CaptureBurst::Response& res)
+{
+    WallTime received = WallTime::now();
+    BurstConfig want = current;
+    int32 error, pointsRead = 0;
+
+    if(!req.channels.empty())
+        want.channels = req.channels;
+    if(req.rate > 0)
+        want.rate = req.rate;
+    if(req.scans > 0)
+        want.scans = req.scans;
+    if(req.min < req.max){
+        want.min = req.min;
+        want.max = req.max;
+    }
+    if(req.trigger == "none"){
+        want.trigger.clear();
+    }else if(!req.trigger.empty()){
+        want.trigger = req.trigger;
+        want.falling = req.falling;
+    }
+    double timeout = req.timeout > 0 ? req.timeout : defaultTimeout;
+
+    res.success = applyConfig(want, &res.message);
+    res.setup_ms = (WallTime::now() - received).toSec()*1e3;
+    if(!res.success)
+        return true;
+
+    error = DAQmxBaseStartTask(taskHandle);
+    res.start_ms = (WallTime::now() - received).toSec()*1e3;
+    if(!DAQmxFailed(error))
+        error = DAQmxBaseReadAnalogF64(taskHandle, current.scans, timeout, DAQmx_Val_GroupByScanNumber, &data[0], data.size(), &pointsRead, NULL);
+    Time readDone = Time::now();
+    DAQmxBaseStopTask(taskHandle);     // ready for the next start either way
+    if(DAQmxFailed(error)){
+        res.success = false;
+        res.message = daqError(error);
+        res.total_ms = (WallTime::now() - received).toSec()*1e3;
+        ROS_WARN("nidaqBurst: %s", res.message.c_str());
+        return true;
+    }
+
+    nidaq::analogInputBlock& block = res.block;
+    block.header.stamp = readDone - Duration(pointsRead/current.rate);
+    block.channels = numChannels;
+    block.scans = pointsRead;
+    block.sample_period = 1.0/current.rate;
+    block.gap_samples = 0;
+    block.layout = nidaq::analogInputBlock::SCAN_MAJOR;
+    block.sample_index = totalScans;
+    block.acquisition_time = block.header.stamp;
+    block.data.resize((size_t)pointsRead*numChannels);
+    nidaq::narrowF64(&data[0], &block.data[0], block.data.size());
+    block.publish_time = Time::now();
+    totalScans += pointsRead;
+
+    res.message = "captured";
+    res.total_ms = (WallTime::now() - received).toSec()*1e3;
+    ROS_INFO("nidaqBurst: %d scans, started %.2f ms after the request, done in %.1f ms", (int)pointsRead, res.start_ms, res.total_ms);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    init(argc, argv, "nidaqBurst");
+    NodeHandle n;
+    NodeHandle pn("~");
+
+    BurstConfig initial;
+    int         scans;
+    std::string message;
+    pn.param("channels", initial.channels, std::string("Dev1/ai0"));
+    pn.param("rate", initial.rate, 250000.0);
+    pn.param("scans", scans, 100000);
+    pn.param("min", initial.min, -10.0);
+    pn.param("max", initial.max, 10.0);
+    pn.param("trigger", initial.trigger, std::string(""));
+    pn.param("falling", initial.falling, false);
+    pn.param("timeout", defaultTimeout, 10.0);
+    initial.scans = scans > 0 ? scans : 0;
+
+    signal(SIGINT, my_handler);
+    ROS_INFO("NIDAQmx Base burst node started");
+    if(!applyConfig(initial, &message)){
+        ROS_ERROR("nidaqBurst: %s", message.c_str());
+        if(taskHandle != 0)
+            DAQmxBaseClearTask(taskHandle);
+        return 1;
+    }
+
+    ServiceServer capture_srv = n.advertiseService("nidaqBurst/capture", captureCallback);
+    spin();
+
+    if(taskHandle != 0){
+        DAQmxBaseStopTask(taskHandle);
+        DAQmxBaseClearTask(taskHandle);
+    }
+    return 0;
+}
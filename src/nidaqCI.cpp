@@ -0,0 +1,278 @@
+/*********************************************************************
+*
+* nidaqCounter:
+*    Buffered counter input on one 6221/6216 counter.
+*
+* Description:
+*    ~mode picks the measurement:
+*      edges      edges counted on the counter source, latched on
+*                 every tick of ~sample_clock
+*      encoder    quadrature (X4) position, latched on every tick of
+*                 ~sample_clock; angular (degrees, ~pulses_per_rev) or
+*                 linear (meters, ~dist_per_pulse)
+*      period     length of each input period, implicitly timed: the
+*                 board stores one sample per period
+*      frequency  the same as 1/period in Hz
+*    The counter fills its hardware buffer on its own; every read takes
+*    a whole block of samples, so nothing is polled from software and
+*    no edge is missed between reads, however fast the input.
+*
+*    For period and frequency ~method low_freq measures every period
+*    with one counter against the 80 MHz timebase. high_freq uses the
+*    neighbouring counter as well and averages over ~divisor periods,
+*    which keeps the resolution at input frequencies in the MHz range.
+*
+*    Blocks of ~block_size samples are published as counterInputBlock
+*    on ~topic (default nidaqCounter). Sample-clocked blocks get their
+*    timestamps from the fitted sample clock as in nidaqAnalog6221.
+*
+* I/O Connections Overview:
+*    Edges and periods are taken on the default source terminal of
+*    ~counter (ctr0: PFI8, ctr1: PFI3), encoder A/B on its A/B inputs
+*    (ctr0: PFI8/PFI10, ctr1: PFI3/PFI11). A counter has no sample
+*    clock of its own: the default /Dev1/ai/SampleClock needs an AI
+*    task running on the same board (nidaqAnalog6221), which also lines
+*    the counter samples up with the AI scans. Any PFI line carrying a
+*    clock at ~rate works as well.
+*
+*********************************************************************/
+
+#include <NIDAQmxBase.h>
+#include "ros/ros.h"
+#include "ros/console.h"
+#include "nidaq/counterInputBlock.h"
+#include "nidaq/sample_clock.h"
+#include "nidaq/daq_recovery.h"
+#include "nidaq/daqDiagnostics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <vector>
+
+#define DAQmxErrChk(functionCall) { if( DAQmxFailed(error=(functionCall)) ) { goto Error; } }
+
+using namespace ros;
+
+static TaskHandle  taskHandle = 0;
+
+void my_handler(int s){
+    printf("Caught signal %d\n",s);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    init(argc, argv, "nidaqCounter");
+    NodeHandle n;
+    NodeHandle pn("~");
+
+    // Task parameters
+    int32       error = 0;
+    char        errBuff[2048]={'\0'};
+
+    // Channel parameters
+    std::string counter, modeName, method, encoderType, clockSource, topic;
+    double      minPeriod, maxPeriod, pulsesPerRev, distPerPulse;
+    int         divisor;
+    pn.param("counter", counter, std::string("Dev1/ctr0"));
+    pn.param("mode", modeName, std::string("edges"));
+    pn.param("method", method, std::string("low_freq"));	//period/frequency: low_freq or high_freq
+    pn.param("divisor", divisor, 4);				//high_freq: periods per sample
+    pn.param("min_period", minPeriod, 1e-6);			//seconds
+    pn.param("max_period", maxPeriod, 1.0);
+    pn.param("encoder", encoderType, std::string("angular"));	//angular or linear
+    pn.param("pulses_per_rev", pulsesPerRev, 1024.0);
+    pn.param("dist_per_pulse", distPerPulse, 1e-3);		//meters
+    pn.param("topic", topic, std::string("nidaqCounter"));
+
+    uint8_t     mode;
+    if(modeName == "edges")
+        mode = nidaq::counterInputBlock::EDGES;
+    else if(modeName == "period")
+        mode = nidaq::counterInputBlock::PERIOD;
+    else if(modeName == "frequency")
+        mode = nidaq::counterInputBlock::FREQUENCY;
+    else if(modeName == "encoder")
+        mode = nidaq::counterInputBlock::ENCODER;
+    else{
+        ROS_ERROR("nidaqCounter: unknown ~mode '%s' (edges, period, frequency or encoder)", modeName.c_str());
+        return 1;
+    }
+    bool        clocked = mode == nidaq::counterInputBlock::EDGES || mode == nidaq::counterInputBlock::ENCODER;
+    bool        highFreq = method == "high_freq";
+    if(divisor < 1 || !highFreq)
+        divisor = 1;
+
+    // Timing parameters
+    double      rate, readTimeout;
+    int         blockSize;
+    pn.param("sample_clock", clockSource, std::string("/Dev1/ai/SampleClock"));
+    pn.param("rate", rate, 1000.0);		//sample clock rate, edges/encoder only
+    pn.param("block_size", blockSize, 100);	//samples per read
+    pn.param("timeout", readTimeout, 1.0);	//period/frequency: longest wait for one period
+    if(blockSize < 1)
+        blockSize = 1;
+    uInt32      inputBuffer = blockSize*10 > 2000 ? blockSize*10 : 2000;
+
+    Publisher   counter_pub = n.advertise <nidaq::counterInputBlock> (topic, 10);
+    Publisher   diag_pub = n.advertise <nidaq::daqDiagnostics> (topic + "/diagnostics", 10);
+
+    // Data read parameters
+    std::vector<uInt32>  counts(blockSize);
+    std::vector<float64> values(blockSize);
+    int32       pointsToRead = blockSize;
+    int32       pointsRead;
+    uInt32      avail;
+    uInt32      lastCount = 0;		//raw count before this block, for the 2^32 wrap
+    uint64_t    edges = 0;		//unwrapped edge count
+    float64     positionOffset = 0;	//encoder position kept across restarts
+    float64     span;
+    float64     timeout = clocked ? 1.0 + blockSize/rate : readTimeout;
+    uint64_t    totalRead = 0;
+    nidaq::counterInputBlock block;
+    nidaq::SampleClock sampleClock(clockSource.find("SampleClock") != std::string::npos ? nidaq::boardSampleRate(rate) : rate);	//a PFI clock runs at whatever it is given
+
+    // Overrun recovery
+    nidaq::RecoveryStats recovery;
+    nidaq::daqDiagnostics diagnostics;
+    uint64_t    pendingGap = 0;
+    Time        now, resumed, lastReport;
+    nidaq::resetRecoveryStats(&recovery);
+
+    block.counter = counter;
+    block.mode = mode;
+    block.data.reserve(blockSize);
+
+    ROS_INFO("NIDAQmx Base counter input: %s, %s, blocks of %d", counter.c_str(), modeName.c_str(), blockSize);
+    DAQmxErrChk (DAQmxBaseCreateTask("", &taskHandle));
+    switch(mode){
+    case nidaq::counterInputBlock::EDGES:
+        DAQmxErrChk (DAQmxBaseCreateCICountEdgesChan(taskHandle, counter.c_str(), "", DAQmx_Val_Rising, 0, DAQmx_Val_CountUp));
+        break;
+    case nidaq::counterInputBlock::ENCODER:
+        if(encoderType == "linear"){
+            DAQmxErrChk (DAQmxBaseCreateCILinEncoderChan(taskHandle, counter.c_str(), "", DAQmx_Val_X4, 0, 0.0, DAQmx_Val_AHighBHigh, DAQmx_Val_Meters, distPerPulse, 0.0, NULL));
+        }else{
+            DAQmxErrChk (DAQmxBaseCreateCIAngEncoderChan(taskHandle, counter.c_str(), "", DAQmx_Val_X4, 0, 0.0, DAQmx_Val_AHighBHigh, DAQmx_Val_Degrees, (uInt32)pulsesPerRev, 0.0, NULL));
+        }
+        break;
+    default:
+        DAQmxErrChk (DAQmxBaseCreateCIPeriodChan(taskHandle, counter.c_str(), "", minPeriod, maxPeriod, DAQmx_Val_Seconds, DAQmx_Val_Rising,
+            highFreq ? DAQmx_Val_HighFreq2Ctr : DAQmx_Val_LowFreq1Ctr, 0.001, divisor, NULL));
+        break;
+    }
+    if(clocked){
+        DAQmxErrChk (DAQmxBaseCfgSampClkTiming(taskHandle, clockSource.c_str(), rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, inputBuffer));
+    }else{
+        DAQmxErrChk (DAQmxBaseCfgImplicitTiming(taskHandle, DAQmx_Val_ContSamps, inputBuffer));
+    }
+    DAQmxErrChk (DAQmxBaseCfgInputBuffer(taskHandle, inputBuffer));
+    DAQmxErrChk (DAQmxBaseStartTask(taskHandle));
+    lastReport = Time::now();
+
+    signal(SIGINT, my_handler);
+    while(ok()) {
+        if(!clocked){
+            //one sample per input period: take what is there, or wait for the next one
+            DAQmxErrChk (DAQmxBaseGetReadAttribute(taskHandle, DAQmx_Read_AvailSampPerChan, &avail));
+            pointsToRead = avail == 0 ? 1 : (avail < (uInt32)blockSize ? avail : blockSize);
+        }
+        if(mode == nidaq::counterInputBlock::EDGES)
+            error = DAQmxBaseReadCounterU32(taskHandle, pointsToRead, timeout, &counts[0], counts.size(), &pointsRead, NULL);
+        else
+            error = DAQmxBaseReadCounterF64(taskHandle, pointsToRead, timeout, &values[0], values.size(), &pointsRead, NULL);
+        now = Time::now();
+        if(DAQmxFailed(error)){
+            nidaq::DaqErrorClass cls = nidaq::classifyDaqError(error);
+            if(cls == nidaq::DAQ_TIMEOUT && !clocked){
+                //no input edges: nothing to measure, not an error
+                error = 0;
+                spinOnce();
+                continue;
+            }
+            if(!nidaq::recoverTask(taskHandle, error, &recovery))
+                goto Error;
+            if(cls == nidaq::DAQ_OVERRUN){
+                //the counter starts over at 0: keep counting from where we were
+                lastCount = 0;
+                if(mode == nidaq::counterInputBlock::ENCODER && !block.data.empty())
+                    positionOffset = block.data.back();
+                if(clocked){
+                    resumed = Time::now();
+                    uint64_t gap = (uint64_t)((resumed - sampleClock.stamp(totalRead)).toSec()*rate + 0.5);
+                    totalRead += gap;
+                    pendingGap += gap;
+                    recovery.gapSamples += gap;
+                    sampleClock.reset(totalRead, resumed);
+                }
+            }
+            error = 0;
+            continue;
+        }
+        if(clocked){
+            DAQmxErrChk (DAQmxBaseGetReadAttribute(taskHandle, DAQmx_Read_AvailSampPerChan, &avail));
+            sampleClock.update(totalRead + pointsRead + avail, now);
+        }
+        if(pointsRead <= 0)
+            continue;
+
+        block.data.resize(pointsRead);
+        switch(mode){
+        case nidaq::counterInputBlock::EDGES:
+            for(int32 i = 0; i < pointsRead; i++){
+                edges += (uInt32)(counts[i] - lastCount);	//modulo 2^32
+                lastCount = counts[i];
+                block.data[i] = (float64)edges;
+            }
+            break;
+        case nidaq::counterInputBlock::ENCODER:
+            for(int32 i = 0; i < pointsRead; i++)
+                block.data[i] = positionOffset + values[i];
+            break;
+        case nidaq::counterInputBlock::PERIOD:
+            for(int32 i = 0; i < pointsRead; i++)
+                block.data[i] = values[i];
+            break;
+        case nidaq::counterInputBlock::FREQUENCY:
+            for(int32 i = 0; i < pointsRead; i++)
+                block.data[i] = values[i] > 0 ? 1.0/values[i] : 0.0;
+            break;
+        }
+
+        if(clocked){
+            block.header.stamp = sampleClock.stamp(totalRead);
+            block.sample_period = sampleClock.period();
+        }else{
+            //the read returned as the last period ended: walk back to the end of the first
+            span = 0;
+            for(int32 i = 1; i < pointsRead; i++)
+                span += values[i]*divisor;
+            block.header.stamp = now - Duration(span);
+            block.sample_period = 0;
+        }
+        block.samples = pointsRead;
+        block.gap_samples = pendingGap;
+        block.sample_index = totalRead;
+        pendingGap = 0;
+        totalRead += pointsRead;
+        counter_pub.publish(block);
+
+        if((now - lastReport).toSec() >= 1.0){
+            nidaq::fillDiagnostics(recovery, &diagnostics);
+            diag_pub.publish(diagnostics);
+            lastReport = now;
+        }
+        spinOnce();
+    }
+
+Error:
+    if( DAQmxFailed(error) )
+        DAQmxBaseGetExtendedErrorInfo(errBuff,2048);
+    if( taskHandle!=0 ) {
+        DAQmxBaseStopTask(taskHandle);
+        DAQmxBaseClearTask(taskHandle);
+    }
+    if( DAQmxFailed(error) )
+        printf ("DAQmxBase Error %ld: %s\n", error, errBuff);
+    return 0;
+}
@@ -0,0 +1,225 @@
+/*********************************************************************
+*
+* nidaqFSR6216:
+*    Force-sensing resistor array with contact detection.
+*
+* Description:
+*    Replaces Ayan6216's single software-timed FSR read. ~channels
+*    (default Dev2/ai0:7) are sampled on the board clock at ~rate and
+*    read ~block_size scans at a time; each scan is scaled by ~scale
+*    and run through nidaq::ContactDetector right here in the read
+*    loop (~on_threshold, ~off_threshold, ~debounce samples). Every
+*    contact change goes out at once on nidaqFSR6216/contact with the
+*    sample clock time of the sample it began at. The force itself is
+*    averaged over ~decimation scans and published on nidaqFSR6216
+*    (fsrInput), ~stream_scans values per message.
+*
+*    Detection latency is the read block plus the debounce: at the
+*    defaults, 2 kS/s in blocks of 2 with a 3-sample debounce, about
+*    2.5 ms from the edge, 1 ms of it waiting for the read.
+*
+* I/O Connections Overview:
+*    One FSR divider per AI channel, referenced single-ended (RSE).
+*
+*********************************************************************/
+
+#include <NIDAQmxBase.h>
+#include "ros/ros.h"
+#include "ros/console.h"
+#include "nidaq/fsrInput.h"
+#include "nidaq/contactEvent.h"
+#include "nidaq/daqDiagnostics.h"
+#include "nidaq/channels.h"
+#include "nidaq/contact_detector.h"
+#include "nidaq/sample_clock.h"
+#include "nidaq/daq_recovery.h"
+#include "nidaq/rt_profile.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define DAQmxErrChk(functionCall) { if( DAQmxFailed(error=(functionCall)) ) { goto Error; } }
+
+using namespace ros;
+
+void my_handler(int s){
+    printf("Caught signal %d\n",s);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    init(argc, argv, "nidaqFSR6216");
+    NodeHandle n;
+    NodeHandle pn("~");
+
+    Publisher force_pub = n.advertise <nidaq::fsrInput> ("nidaqFSR6216", 10);
+    Publisher contact_pub = n.advertise <nidaq::contactEvent> ("nidaqFSR6216/contact", 100);
+    Publisher diag_pub = n.advertise <nidaq::daqDiagnostics> ("nidaqFSR6216/diagnostics", 10);
+
+    // Real-time profile, off unless ~rt/enabled is set
+    nidaq::RtProfile rt;
+    nidaq::loadRtProfile(pn, &rt);
+
+    // Channel and timing parameters
+    std::string chan;
+    double      rate, minAI, maxAI, scale;
+    int         blockSize, decimation, streamScans;
+    pn.param("channels", chan, std::string("Dev2/ai0:7"));
+    pn.param("rate", rate, 2000.0);
+    pn.param("block_size", blockSize, 2);	//scans per read: the detection latency
+    pn.param("min", minAI, -10.0);
+    pn.param("max", maxAI, 10.0);
+    pn.param("scale", scale, 1.0);		//force units per volt
+    pn.param("decimation", decimation, 20);
+    pn.param("stream_scans", streamScans, 1);
+
+    // Contact detection
+    double      onThreshold, offThreshold;
+    int         debounce;
+    pn.param("on_threshold", onThreshold, 1.0);
+    pn.param("off_threshold", offThreshold, 0.5);
+    pn.param("debounce", debounce, 3);
+
+    int         numChannels = nidaq::countChannels(chan);
+    nidaq::ContactDetector detector;
+    if(numChannels == 0 || rate <= 0 || blockSize < 1 || decimation < 1 || streamScans < 1){
+        ROS_ERROR("nidaqFSR6216: bad ~channels, ~rate, ~block_size, ~decimation or ~stream_scans");
+        return 1;
+    }
+    if(!detector.configure(numChannels, onThreshold, offThreshold, debounce))
+        return 1;
+
+    // Task parameters
+    int32       error = 0;
+    TaskHandle  taskHandle = 0;
+    char        errBuff[2048]={'\0'};
+
+    // Data read parameters
+    std::vector<float64> data(numChannels*blockSize);
+    int32       pointsRead;
+    uInt32      avail;
+    uInt32      inputBuffer = blockSize*10 > 2000 ? blockSize*10 : 2000;
+    float64     timeout = 1.0 + blockSize/rate;
+    uInt64      totalRead = 0;
+    nidaq::SampleClock sampleClock(nidaq::boardSampleRate(rate));
+
+    // Detection and the decimated stream
+    std::vector<nidaq::ContactChange> changes;
+    nidaq::contactEvent event;
+    nidaq::fsrInput stream;
+    std::vector<double> sums(numChannels, 0.0);
+    int         summed = 0;		//scans in sums
+    changes.reserve(numChannels*blockSize);
+    stream.decimation = decimation;
+    stream.channels = numChannels;
+    stream.sample_period = decimation/rate;
+    stream.force.reserve(numChannels*streamScans);
+    stream.contact.resize(numChannels);
+
+    // Overrun recovery
+    nidaq::RecoveryStats recovery;
+    nidaq::daqDiagnostics diagnostics;
+    uInt64      pendingGap = 0;
+    Time        resumed, lastReport;
+    nidaq::resetRecoveryStats(&recovery);
+
+    nidaq::applyRtProfile(rt);
+
+    ROS_INFO("NIDAQmx Base FSR node started: %s, %d channels at %.0f S/s", chan.c_str(), numChannels, rate);
+    DAQmxErrChk (DAQmxBaseCreateTask("", &taskHandle));
+    DAQmxErrChk (DAQmxBaseCreateAIVoltageChan(taskHandle, chan.c_str(), "", DAQmx_Val_RSE, minAI, maxAI, DAQmx_Val_Volts, NULL));
+    DAQmxErrChk (DAQmxBaseCfgSampClkTiming(taskHandle, "OnboardClock", rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, inputBuffer));
+    DAQmxErrChk (DAQmxBaseCfgInputBuffer(taskHandle, inputBuffer));
+    DAQmxErrChk (DAQmxBaseStartTask(taskHandle));
+    signal(SIGINT, my_handler);
+    lastReport = Time::now();
+
+    while(ok()){
+        error = DAQmxBaseReadAnalogF64(taskHandle, blockSize, timeout, DAQmx_Val_GroupByScanNumber, &data[0], data.size(), &pointsRead, NULL);
+        if(DAQmxFailed(error)){
+            if(!nidaq::recoverTask(taskHandle, error, &recovery))
+                goto Error;
+            if(nidaq::classifyDaqError(error) == nidaq::DAQ_OVERRUN){
+                //lost scans: the sample index jumps, a half-summed value and
+                //the debounce runs in progress are dropped
+                resumed = Time::now();
+                uInt64 gap = (uInt64)((resumed - sampleClock.stamp(totalRead)).toSec()*rate + 0.5);
+                totalRead += gap;
+                pendingGap += gap;
+                recovery.gapSamples += gap;
+                sampleClock.reset(totalRead, resumed);
+                detector.restartRuns();
+                summed = 0;
+                sums.assign(numChannels, 0.0);
+                stream.force.clear();
+            }
+            error = 0;
+            continue;
+        }
+        DAQmxErrChk (DAQmxBaseGetReadAttribute(taskHandle, DAQmx_Read_AvailSampPerChan, &avail));
+        sampleClock.update(totalRead + pointsRead + avail, Time::now());
+        if(pointsRead <= 0)
+            continue;
+
+        for(size_t k = 0; k < (size_t)pointsRead*numChannels; k++)
+            data[k] *= scale;
+
+        //contact changes first, they are what is waited for
+        changes.clear();
+        detector.process(&data[0], pointsRead, totalRead, &changes);
+        for(size_t e = 0; e < changes.size(); e++){
+            event.header.stamp = sampleClock.stamp(changes[e].sample);
+            event.channel = changes[e].channel;
+            event.state = changes[e].contact ? nidaq::contactEvent::CONTACT : nidaq::contactEvent::RELEASE;
+            event.sample_index = changes[e].sample;
+            event.force = changes[e].force;
+            contact_pub.publish(event);
+        }
+
+        for(int32 s = 0; s < pointsRead; s++){
+            if(summed == 0 && stream.force.empty()){
+                stream.sample_index = totalRead + s;
+                stream.header.stamp = sampleClock.stamp(stream.sample_index);
+                stream.gap_samples = pendingGap;
+                pendingGap = 0;
+            }
+            for(int c = 0; c < numChannels; c++)
+                sums[c] += data[s*numChannels + c];
+            if(++summed < decimation)
+                continue;
+            for(int c = 0; c < numChannels; c++){
+                stream.force.push_back((float)(sums[c]/decimation));
+                sums[c] = 0;
+            }
+            summed = 0;
+            if((int)stream.force.size() < numChannels*streamScans)
+                continue;
+            for(int c = 0; c < numChannels; c++)
+                stream.contact[c] = detector.contact(c);
+            stream.scans = streamScans;
+            force_pub.publish(stream);
+            stream.force.clear();
+        }
+        totalRead += pointsRead;
+
+        if((Time::now() - lastReport).toSec() >= 1.0){
+            nidaq::fillDiagnostics(recovery, &diagnostics);
+            diag_pub.publish(diagnostics);
+            lastReport = Time::now();
+        }
+        spinOnce();
+    }
+
+Error:
+    if( DAQmxFailed(error) )
+        DAQmxBaseGetExtendedErrorInfo(errBuff,2048);
+    if( taskHandle!=0 ) {
+        DAQmxBaseStopTask(taskHandle);
+        DAQmxBaseClearTask(taskHandle);
+    }
+    if( DAQmxFailed(error) )
+        printf ("DAQmxBase Error %ld: %s\n", error, errBuff);
+    return 0;
+}
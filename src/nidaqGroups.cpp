@@ -0,0 +1,145 @@
+/*********************************************************************
+*
+* nidaqGroups:
+*    Several independently clocked tasks in one process.
+*
+* Description:
+*    ~groups names the task groups, each configured under ~<name>/
+*    (see nidaq/task_group.h), e.g. slow housekeeping AI, fast ai0, an
+*    AO waveform or file stream and a CO pulse train side by side:
+*
+*        groups: [housekeeping, fast, drive, pwm]
+*        housekeeping: {type: ai, channels: Dev1/ai1:15, rate: 10, block_size: 1}
+*        fast:         {type: ai, channels: Dev1/ai0, rate: 50000, block_size: 500}
+*        drive:        {type: ao, channels: Dev1/ao0, rate: 10000, waveforms: ["sine:2.5"]}
+*        pwm:          {type: co, counter: Dev1/ctr0, frequency: 1000, duty: 0.25}
+*
+*    Every group has its own service thread and its own queue to the
+*    publisher (this thread), and none of them blocks inside the
+*    driver, so each runs at its own rate whatever the others do. AI
+*    blocks go out on nidaqGroups/<name> as analogInputBlock. Every
+*    ~stats_period seconds each group's achieved rate is logged, and
+*    its recovery counters go to nidaqGroups/<name>/diagnostics once a
+*    second. A group with a fatal error is stopped, the others go on.
+*
+* I/O Connections Overview:
+*    As for the single-task nodes; a board takes one task per
+*    subsystem (AI, AO, each counter), so two AI groups need two boards.
+*
+*********************************************************************/
+
+#include "ros/ros.h"
+#include "ros/console.h"
+#include "nidaq/task_group.h"
+#include "nidaq/analogInputBlock.h"
+#include "nidaq/daqDiagnostics.h"
+#include <errno.h>
+#include <semaphore.h>
+#include <time.h>
+#include <vector>
+
+using namespace ros;
+
+int main(int argc, char *argv[])
+{
+    init(argc, argv, "nidaqGroups");
+    NodeHandle n;
+    NodeHandle pn("~");
+
+    std::vector<std::string> names;
+    double      statsPeriod;
+    pn.getParam("groups", names);
+    pn.param("stats_period", statsPeriod, 10.0);
+    if(names.empty()){
+        ROS_ERROR("nidaqGroups: ~groups is empty");
+        return 1;
+    }
+
+    std::vector<nidaq::TaskGroup*> groups;
+    std::vector<Publisher> block_pubs, diag_pubs;
+    std::vector<bool> stopped;
+    for(size_t g = 0; g < names.size(); g++){
+        nidaq::TaskGroup *group = nidaq::createTaskGroup(names[g], NodeHandle(pn, names[g]));
+        if(group == NULL){
+            for(size_t i = 0; i < groups.size(); i++)
+                delete groups[i];
+            return 1;
+        }
+        groups.push_back(group);
+        block_pubs.push_back(group->type() == "ai" ? n.advertise <nidaq::analogInputBlock> ("nidaqGroups/" + names[g], 10) : Publisher());
+        diag_pubs.push_back(n.advertise <nidaq::daqDiagnostics> ("nidaqGroups/" + names[g] + "/diagnostics", 10));
+        stopped.push_back(false);
+    }
+
+    // every group posts here when it has queued a block
+    sem_t       ready;
+    sem_init(&ready, 0, 0);
+    size_t      running = 0;
+    for(size_t g = 0; g < groups.size(); g++){
+        if(groups[g]->start(&ready)){
+            running++;
+        }else{
+            ROS_ERROR("nidaqGroups: group %s did not start", groups[g]->name().c_str());
+            stopped[g] = true;
+        }
+    }
+    ROS_INFO("NIDAQmx Base task groups started: %lu of %lu", (unsigned long)running, (unsigned long)groups.size());
+
+    nidaq::daqDiagnostics diagnostics;
+    nidaq::analogInputBlock *block;
+    WallTime    lastReport = WallTime::now();
+    WallTime    lastStats = lastReport;
+    struct timespec deadline;
+
+    while(ok() && running > 0){
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 100000000;
+        if(deadline.tv_nsec >= 1000000000){
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        while(sem_timedwait(&ready, &deadline) == -1 && errno == EINTR)
+            ;
+
+        for(size_t g = 0; g < groups.size(); g++){
+            while((block = groups[g]->pop()) != NULL){
+                block->publish_time = Time::now();
+                block_pubs[g].publish(*block);
+                groups[g]->recycle(block);
+            }
+            if(groups[g]->failed() && !stopped[g]){
+                ROS_ERROR("nidaqGroups: group %s failed and is stopped", groups[g]->name().c_str());
+                groups[g]->stop();
+                stopped[g] = true;
+                running--;
+            }
+        }
+
+        WallTime now = WallTime::now();
+        if((now - lastReport).toSec() >= 1.0){
+            for(size_t g = 0; g < groups.size(); g++){
+                nidaq::fillDiagnostics(groups[g]->stats().recovery, &diagnostics);
+                diag_pubs[g].publish(diagnostics);
+            }
+            lastReport = now;
+        }
+        if(statsPeriod > 0 && (now - lastStats).toSec() >= statsPeriod){
+            for(size_t g = 0; g < groups.size(); g++){
+                nidaq::TaskGroup::Stats stats = groups[g]->stats();
+                ROS_INFO("group %-12s %s %10.1f of %10.1f /s, %llu blocks, %llu dropped, %llu overruns, %llu underruns",
+                    groups[g]->name().c_str(), groups[g]->type().c_str(), groups[g]->achievedRate(), groups[g]->rate(),
+                    (unsigned long long)stats.blocks, (unsigned long long)stats.dropped,
+                    (unsigned long long)stats.recovery.overruns, (unsigned long long)stats.recovery.underruns);
+            }
+            lastStats = now;
+        }
+        spinOnce();
+    }
+
+    for(size_t g = 0; g < groups.size(); g++){
+        groups[g]->stop();  // joins the thread before the group's members go
+        delete groups[g];
+    }
+    sem_destroy(&ready);
+    return 0;
+}
@@ -0,0 +1,261 @@
+/*********************************************************************
+*
+* nidaqLockIn:
+*    Lock-in amplifier on the 6221: ao0 excitation, ai0:15 responses.
+*
+* Description:
+*    ~ao_channel (default Dev1/ao0) regenerates one ~ao_scans buffer of
+*    ~excitation (nidaq/waveform.h syntax, default sine:1:0:10, so
+*    10 periods per buffer). It has no clock of its own but runs on
+*    ~sample_clock, the AI sample clock of the same board: it is
+*    started first and waits, and starting the AI task starts both, so
+*    AO sample n mod ao_scans goes out on the tick that takes AI scan n.
+*    The quadrature reference is built from the same spec and indexed
+*    by the scan's position in the AO buffer, which keeps it coherent
+*    with the excitation for as long as the tasks run.
+*
+*    ~channels (default Dev1/ai0:15) are read in blocks of ~block_size
+*    scans at ~rate and demodulated right in the read loop by
+*    nidaq::LockIn: mixing plus ~order low-pass stages of
+*    ~time_constant on all channels at once in SIMD lanes. Amplitude,
+*    phase, x and y of every channel are published ~output_rate times
+*    a second as lockIn on nidaqLockIn, so only the demodulated values
+*    leave the node.
+*
+*    On an overrun both tasks are stopped and started again, AO first,
+*    so the AO buffer starts over with the next scan; the filters keep
+*    their state and settled goes false for one settle time.
+*
+* I/O Connections Overview:
+*    ao0 drives the system under test, its responses go to ai0:15,
+*    referenced single-ended (RSE). Nothing else is wired: the AO
+*    clock is routed inside the board.
+*
+*********************************************************************/
+
+#include <NIDAQmxBase.h>
+#include "ros/ros.h"
+#include "ros/console.h"
+#include "nidaq/lockIn.h"
+#include "nidaq/daqDiagnostics.h"
+#include "nidaq/channels.h"
+#include "nidaq/waveform.h"
+#include "nidaq/lockin.h"
+#include "nidaq/sample_clock.h"
+#include "nidaq/daq_recovery.h"
+#include "nidaq/rt_profile.h"
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define DAQmxErrChk(functionCall) { if( DAQmxFailed(error=(functionCall)) ) { goto Error; } }
+
+using namespace ros;
+
+void my_handler(int s){
+    printf("Caught signal %d\n",s);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    init(argc, argv, "nidaqLockIn");
+    NodeHandle n;
+    NodeHandle pn("~");
+
+    Publisher lockin_pub = n.advertise <nidaq::lockIn> ("nidaqLockIn", 10);
+    Publisher diag_pub = n.advertise <nidaq::daqDiagnostics> ("nidaqLockIn/diagnostics", 10);
+
+    // Real-time profile, off unless ~rt/enabled is set
+    nidaq::RtProfile rt;
+    nidaq::loadRtProfile(pn, &rt);
+
+    // Excitation
+    std::string aoChan, excitationText, clockSource;
+    double      minAO, maxAO;
+    int         aoScans;
+    pn.param("ao_channel", aoChan, std::string("Dev1/ao0"));
+    pn.param("excitation", excitationText, std::string("sine:1:0:10"));
+    pn.param("ao_scans", aoScans, 1000);	//AO buffer length
+    pn.param("ao_min", minAO, -10.0);
+    pn.param("ao_max", maxAO, 10.0);
+    pn.param("sample_clock", clockSource, std::string("/Dev1/ai/SampleClock"));
+
+    // Acquisition
+    std::string chan;
+    double      rate, minAI, maxAI;
+    int         blockSize;
+    pn.param("channels", chan, std::string("Dev1/ai0:15"));
+    pn.param("rate", rate, 10000.0);
+    pn.param("block_size", blockSize, 100);
+    pn.param("min", minAI, -10.0);
+    pn.param("max", maxAI, 10.0);
+
+    // Demodulation
+    double      timeConstant, outputRate;
+    int         order;
+    pn.param("time_constant", timeConstant, 0.1);	//s, per stage
+    pn.param("order", order, 2);			//1..4 stages
+    pn.param("output_rate", outputRate, 10.0);		//Hz
+
+    int         numChannels = nidaq::countChannels(chan);
+    nidaq::WaveformSpec excitation;
+    nidaq::LockIn lockin;
+    if(numChannels == 0 || rate <= 0 || blockSize < 1 || aoScans < 2 || outputRate <= 0){
+        ROS_ERROR("nidaqLockIn: bad ~channels, ~rate, ~block_size, ~ao_scans or ~output_rate");
+        return 1;
+    }
+    if(!nidaq::parseWaveform(excitationText, &excitation))
+        return 1;
+    if(!lockin.configure(excitation, aoScans, numChannels, rate, timeConstant, order))
+        return 1;
+
+    // Task parameters
+    int32       error = 0;
+    int32       readError, aoError;	//an overrun's read error survives the AO restart
+    TaskHandle  aiTask = 0, aoTask = 0;
+    char        errBuff[2048]={'\0'};
+
+    // Excitation buffer, generated once
+    std::vector<float64> aoBuffer(aoScans);
+    int32       pointsWritten;
+    nidaq::fillWaveform(excitation, &aoBuffer[0], aoScans);
+
+    // Data read parameters
+    std::vector<float64> data(numChannels*blockSize);
+    int32       pointsRead;
+    uInt32      avail;
+    uInt32      inputBuffer = blockSize*10 > 2000 ? blockSize*10 : 2000;
+    float64     timeout = 1.0 + blockSize/rate;
+    uInt64      totalRead = 0;
+    uInt64      aoStart = 0;		//scan the AO buffer last started on
+    uInt64      settledAt = (uInt64)ceil(lockin.settleTime()*rate);
+    nidaq::SampleClock sampleClock(nidaq::boardSampleRate(rate));
+
+    // Output
+    uInt32      outputEvery = (uInt32)(rate/outputRate + 0.5);
+    uInt32      untilOutput;
+    double      x, y, amplitude, phase;
+    nidaq::lockIn result;
+    if(outputEvery < 1)
+        outputEvery = 1;
+    untilOutput = outputEvery;
+    result.frequency = lockin.frequency();
+    result.time_constant = timeConstant;
+    result.order = order;
+    result.settle_time = lockin.settleTime();
+    result.channels = numChannels;
+    result.amplitude.resize(numChannels);
+    result.phase.resize(numChannels);
+    result.x.resize(numChannels);
+    result.y.resize(numChannels);
+
+    // Overrun recovery
+    nidaq::RecoveryStats recovery;
+    nidaq::daqDiagnostics diagnostics;
+    Time        resumed, lastReport;
+    nidaq::resetRecoveryStats(&recovery);
+
+    nidaq::applyRtProfile(rt);
+
+    ROS_INFO("NIDAQmx Base lock-in started: %s at %.3f Hz on %s, %d channels at %.0f S/s, tau %.3f s x%d",
+        aoChan.c_str(), lockin.frequency(), chan.c_str(), numChannels, rate, timeConstant, order);
+    DAQmxErrChk (DAQmxBaseCreateTask("", &aiTask));
+    DAQmxErrChk (DAQmxBaseCreateAIVoltageChan(aiTask, chan.c_str(), "", DAQmx_Val_RSE, minAI, maxAI, DAQmx_Val_Volts, NULL));
+    DAQmxErrChk (DAQmxBaseCfgSampClkTiming(aiTask, "OnboardClock", rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, inputBuffer));
+    DAQmxErrChk (DAQmxBaseCfgInputBuffer(aiTask, inputBuffer));
+
+    DAQmxErrChk (DAQmxBaseCreateTask("", &aoTask));
+    DAQmxErrChk (DAQmxBaseCreateAOVoltageChan(aoTask, aoChan.c_str(), "", minAO, maxAO, DAQmx_Val_Volts, NULL));
+    DAQmxErrChk (DAQmxBaseCfgSampClkTiming(aoTask, clockSource.c_str(), rate, DAQmx_Val_Rising, DAQmx_Val_ContSamps, aoScans));
+    DAQmxErrChk (DAQmxBaseWriteAnalogF64(aoTask, aoScans, 0, 10.0, DAQmx_Val_GroupByChannel, &aoBuffer[0], &pointsWritten, NULL));
+
+    //AO first: it waits for the AI clock
+    DAQmxErrChk (DAQmxBaseStartTask(aoTask));
+    DAQmxErrChk (DAQmxBaseStartTask(aiTask));
+    signal(SIGINT, my_handler);
+    lastReport = Time::now();
+
+    while(ok()){
+        error = DAQmxBaseReadAnalogF64(aiTask, blockSize, timeout, DAQmx_Val_GroupByScanNumber, &data[0], data.size(), &pointsRead, NULL);
+        if(DAQmxFailed(error)){
+            readError = error;
+            if(nidaq::classifyDaqError(readError) == nidaq::DAQ_OVERRUN){
+                //the AO buffer starts over with the first scan after the restart
+                DAQmxBaseStopTask(aiTask);
+                DAQmxBaseStopTask(aoTask);
+                aoError = DAQmxBaseWriteAnalogF64(aoTask, aoScans, 0, 10.0, DAQmx_Val_GroupByChannel, &aoBuffer[0], &pointsWritten, NULL);
+                if(!DAQmxFailed(aoError))
+                    aoError = DAQmxBaseStartTask(aoTask);
+                if(DAQmxFailed(aoError)){
+                    error = aoError;
+                    goto Error;
+                }
+            }
+            if(!nidaq::recoverTask(aiTask, readError, &recovery))
+                goto Error;
+            if(nidaq::classifyDaqError(readError) == nidaq::DAQ_OVERRUN){
+                resumed = Time::now();
+                uInt64 gap = (uInt64)((resumed - sampleClock.stamp(totalRead)).toSec()*rate + 0.5);
+                totalRead += gap;
+                recovery.gapSamples += gap;
+                sampleClock.reset(totalRead, resumed);
+                aoStart = totalRead;
+                settledAt = totalRead + (uInt64)ceil(lockin.settleTime()*rate);
+            }
+            error = 0;
+            continue;
+        }
+        DAQmxErrChk (DAQmxBaseGetReadAttribute(aiTask, DAQmx_Read_AvailSampPerChan, &avail));
+        sampleClock.update(totalRead + pointsRead + avail, Time::now());
+
+        //demodulate up to each output point, publish there
+        for(int32 s = 0; s < pointsRead; ){
+            uInt32 scans = (uInt32)(pointsRead - s) < untilOutput ? (uInt32)(pointsRead - s) : untilOutput;
+            lockin.process(&data[(size_t)s*numChannels], scans, totalRead + s - aoStart);
+            s += scans;
+            untilOutput -= scans;
+            if(untilOutput > 0)
+                continue;
+            untilOutput = outputEvery;
+
+            result.sample_index = totalRead + s - 1;
+            result.header.stamp = sampleClock.stamp(result.sample_index);
+            result.settled = result.sample_index >= settledAt;
+            for(int c = 0; c < numChannels; c++){
+                lockin.result(c, &x, &y);
+                lockin.polar(c, &amplitude, &phase);
+                result.x[c] = (float)x;
+                result.y[c] = (float)y;
+                result.amplitude[c] = (float)amplitude;
+                result.phase[c] = (float)phase;
+            }
+            lockin_pub.publish(result);
+        }
+        totalRead += pointsRead;
+
+        if((Time::now() - lastReport).toSec() >= 1.0){
+            nidaq::fillDiagnostics(recovery, &diagnostics);
+            diag_pub.publish(diagnostics);
+            lastReport = Time::now();
+        }
+        spinOnce();
+    }
+
+Error:
+    if( DAQmxFailed(error) )
+        DAQmxBaseGetExtendedErrorInfo(errBuff,2048);
+    if( aiTask!=0 ) {
+        DAQmxBaseStopTask(aiTask);
+        DAQmxBaseClearTask(aiTask);
+    }
+    if( aoTask!=0 ) {
+        DAQmxBaseStopTask(aoTask);
+        DAQmxBaseClearTask(aoTask);
+    }
+    if( DAQmxFailed(error) )
+        printf ("DAQmxBase Error %ld: %s\n", error, errBuff);
+    return 0;
+}
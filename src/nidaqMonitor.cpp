@@ -0,0 +1,100 @@
+/*********************************************************************
+*
+* nidaqMonitor:
+*    Loss and latency of one AI stream, as its subscribers see it.
+*
+* Description:
+*    Subscribes to ~topic (~type scan: analogInput, block:
+*    analogInputBlock) and follows sample_index through
+*    nidaq::StreamMonitor. Every ~period seconds it publishes a
+*    streamStats on <topic>/stats and logs a line, then starts the next
+*    period. Per-scan topics carry one scan per read, so ~stride is the
+*    scans per read: 16 for Modified6221, ~block_size for
+*    nidaqAnalog6221.
+*
+*        rosrun nidaq nidaqMonitor _topic:=nidaqAnalog6221/block _type:=block
+*        rosrun nidaq nidaqMonitor _topic:=Modified6221 _type:=scan _stride:=16
+*
+*    ~queue_size is the subscriber queue (default 1, as most nodes in
+*    this package publish with); a larger one shows what the publisher
+*    side alone drops. Latency needs the publisher and this node on one
+*    clock: the same host, or hosts kept in sync by NTP/PTP.
+*
+*********************************************************************/
+
+#include "ros/ros.h"
+#include "ros/console.h"
+#include "nidaq/stream_monitor.h"
+#include "nidaq/analogInput.h"
+#include "nidaq/analogInputBlock.h"
+#include "nidaq/streamStats.h"
+
+using namespace ros;
+
+static nidaq::StreamMonitor monitor;
+static int stride = 1;
+static Publisher stats_pub;
+static nidaq::streamStats stats;
+static WallTime lastReport;
+
+static void scanCallback(const nidaq::analogInput::ConstPtr& msg)
+{
+    monitor.update(msg->sample_index, stride, msg->gap_samples, msg->acquisition_time, msg->publish_time, Time::now());
+}
+
+static void blockCallback(const nidaq::analogInputBlock::ConstPtr& msg)
+{
+    monitor.update(msg->sample_index, msg->scans, msg->gap_samples, msg->acquisition_time, msg->publish_time, Time::now());
+}
+
+// from the same spin() thread as the subscriptions, so nothing is shared across threads
+static void reportCallback(const WallTimerEvent&)
+{
+    WallTime now = WallTime::now();
+    stats.header.stamp = Time::now();
+    stats.period = (now - lastReport).toSec();
+    monitor.fill(&stats);
+    stats_pub.publish(stats);
+    ROS_INFO("%s: %llu msgs, %llu dropped (%llu scans), %llu reordered, latency %.3f/%.3f/%.3f ms (min/p50/p99), max %.3f ms",
+        stats.topic.c_str(), (unsigned long long)stats.messages, (unsigned long long)stats.dropped_messages,
+        (unsigned long long)stats.dropped_samples, (unsigned long long)stats.reordered,
+        stats.latency_min*1e3, stats.latency_p50*1e3, stats.latency_p99*1e3, stats.latency_max*1e3);
+    monitor.reset();
+    lastReport = now;
+}
+
+int main(int argc, char *argv[])
+{
+    init(argc, argv, "nidaqMonitor");
+    NodeHandle n;
+    NodeHandle pn("~");
+
+    std::string topic, type;
+    double      period;
+    int         queueSize;
+    pn.param("topic", topic, std::string("nidaqAnalog6221/block"));
+    pn.param("type", type, std::string("block"));
+    pn.param("stride", stride, 1);
+    pn.param("period", period, 1.0);
+    pn.param("queue_size", queueSize, 1);
+    if(stride < 1 || period <= 0 || (type != "scan" && type != "block")){
+        ROS_ERROR("nidaqMonitor: ~type must be scan or block, ~stride and ~period positive");
+        return 1;
+    }
+
+    Subscriber sub;
+    if(type == "scan")
+        sub = n.subscribe(topic, queueSize, scanCallback, TransportHints().tcpNoDelay());
+    else
+        sub = n.subscribe(topic, queueSize, blockCallback, TransportHints().tcpNoDelay());
+    stats_pub = n.advertise <nidaq::streamStats> (topic + "/stats", 10);
+    ROS_INFO("nidaqMonitor: watching %s (%s)", topic.c_str(), type.c_str());
+
+    stats.topic = topic;
+    lastReport = WallTime::now();
+    WallTimer report = n.createWallTimer(WallDuration(period), reportCallback);
+
+    //callbacks run as the messages arrive, so the latency holds no polling delay of our own
+    spin();
+    return 0;
+}
@@ -0,0 +1,303 @@
+/*********************************************************************
+*
+* nidaqServer:
+*    Long-lived task host, configured at runtime through services.
+*
+* Description:
+*    Loading the DAQmx Base driver takes seconds; this node pays that
+*    once and then keeps its task groups (see nidaq/task_group.h)
+*    warm. Groups are built from ~<name>/ parameters like nidaqGroups',
+*    either listed in ~groups at startup (started unless ~autostart is
+*    false) or created later with
+*
+*        nidaqServer/configure   ConfigureTask: create or replace a group
+*        nidaqServer/start       TaskControl: start it
+*        nidaqServer/stop        TaskControl: stop it, the task is kept
+*        nidaqServer/retune      RetuneTask: rate, waveforms, amplitude,
+*                                channels or duty of an existing group
+*
+*    e.g.
+*        rosservice call /nidaqServer/configure "{name: drive, type: ao, channels: Dev1/ao0, rate: 10000, waveforms: ['sine:2.5']}"
+*        rosservice call /nidaqServer/start "{name: drive}"
+*        rosservice call /nidaqServer/retune "{name: drive, rate: 20000, amplitude: 1.0}"
+*
+*    A retune the task can take (AI rate; AO rate, waveforms and
+*    amplitude) is applied to the stopped task and the group restarted;
+*    anything else rebuilds the group. Every reply carries the time it
+*    took in latency_ms, which is also logged. AI blocks go out on
+*    nidaqServer/<name>, recovery counters on
+*    nidaqServer/<name>/diagnostics once a second.
+*
+*********************************************************************/
+
+#include "ros/ros.h"
+#include "ros/console.h"
+#include "nidaq/task_group.h"
+#include "nidaq/analogInputBlock.h"
+#include "nidaq/daqDiagnostics.h"
+#include "nidaq/ConfigureTask.h"
+#include "nidaq/TaskControl.h"
+#include "nidaq/RetuneTask.h"
+#include <errno.h>
+#include <semaphore.h>
+#include <time.h>
+#include <map>
+#include <vector>
+
+using namespace ros;
+
+struct Slot {
+    nidaq::TaskGroup    *group;
+    Publisher           block_pub;
+    Publisher           diag_pub;
+    bool                failReported;
+};
+
+static std::map<std::string, Slot> slots;
+static NodeHandle   *topics;
+static NodeHandle   *params;       // each group under ~<name>/
+static sem_t        ready;         // posted by a group with a block queued
+
+static double msSince(const WallTime& start)
+{
+    return (WallTime::now() - start).toSec()*1e3;
+}
+
+// a request field into ~<name>/key, or the parameter removed so the default applies
+template <class T>
+static void setOrClear(const NodeHandle& nh, const std::string& key, bool set, const T& value)
+{
+    if(set)
+        nh.setParam(key, value);
+    else
+        nh.deleteParam(key);
+}
+
+template <class T>
+static void setIf(const NodeHandle& nh, const std::string& key, bool set, const T& value)
+{
+    if(set)
+        nh.setParam(key, value);
+}
+
+// publishes what a group still has queued, e.g. before it is paused
+static void drain(Slot& slot)
+{
+    nidaq::analogInputBlock *block;
+    while((block = slot.group->pop()) != NULL){
+        block->publish_time = Time::now();
+        slot.block_pub.publish(*block);
+        slot.group->recycle(block);
+    }
+}
+
+static bool addGroup(const std::string& name, std::string* message)
+{
+    nidaq::TaskGroup *group = nidaq::createTaskGroup(name, NodeHandle(*params, name));
+    if(group == NULL){
+        *message = "cannot create group " + name + ", see the log";
+        return false;
+    }
+    Slot slot;
+    slot.group = group;
+    slot.failReported = false;
+    if(group->type() == "ai")
+        slot.block_pub = topics->advertise <nidaq::analogInputBlock> ("nidaqServer/" + name, 10);
+    slot.diag_pub = topics->advertise <nidaq::daqDiagnostics> ("nidaqServer/" + name + "/diagnostics", 10);
+    slots[name] = slot;
+    *message = "created " + name;
+    return true;
+}
+
+static void removeGroup(const std::string& name)
+{
+    std::map<std::string, Slot>::iterator it = slots.find(name);
+    if(it == slots.end())
+        return;
+    it->second.group->pause();
+    drain(it->second);
+    delete it->second.group;    // clears the task
+    slots.erase(it);
+}
+
+static bool startGroup(Slot& slot, std::string* message)
+{
+    if(!slot.group->start(&ready)){
+        *message = "cannot start " + slot.group->name();
+        return false;
+    }
+    slot.failReported = false;
+    *message = "started " + slot.group->name();
+    return true;
+}
+
+static bool configureCallback(nidaq::ConfigureTask::Request& req, nidaq::ConfigureTask::Response& res)
+{
+    WallTime start = WallTime::now();
+    if(req.name.empty() || (req.type != "ai" && req.type != "ao" && req.type != "co")){
+        res.success = false;
+        res.message = "a name and a type (ai, ao or co) are needed";
+        return true;
+    }
+
+    NodeHandle nh(*params, req.name);
+    bool co = (req.type == "co");
+    nh.setParam("type", req.type);
+    setOrClear(nh, co ? "counter" : "channels", !req.channels.empty(), req.channels);
+    setOrClear(nh, co ? "frequency" : "rate", req.rate > 0, req.rate);
+    setOrClear(nh, "min", req.min < req.max, req.min);
+    setOrClear(nh, "max", req.min < req.max, req.max);
+    setOrClear(nh, "block_size", req.block_size > 0, (int)req.block_size);
+    setOrClear(nh, "waveforms", !req.waveforms.empty(), req.waveforms);
+    setOrClear(nh, "amplitude", req.amplitude != 0, req.amplitude);
+    setOrClear(nh, "duty", req.duty > 0, req.duty);
+
+    removeGroup(req.name);
+    res.success = addGroup(req.name, &res.message);
+    res.latency_ms = msSince(start);
+    ROS_INFO("nidaqServer: configure %s: %s (%.1f ms)", req.name.c_str(), res.message.c_str(), res.latency_ms);
+    return true;
+}
+
+static bool startCallback(nidaq::TaskControl::Request& req, nidaq::TaskControl::Response& res)
+{
+    WallTime start = WallTime::now();
+    std::map<std::string, Slot>::iterator it = slots.find(req.name);
+    if(it == slots.end()){
+        res.success = false;
+        res.message = "no group " + req.name;
+    }else{
+        res.success = startGroup(it->second, &res.message);
+    }
+    res.latency_ms = msSince(start);
+    ROS_INFO("nidaqServer: start %s: %s (%.1f ms)", req.name.c_str(), res.message.c_str(), res.latency_ms);
+    return true;
+}
+
+static bool stopCallback(nidaq::TaskControl::Request& req, nidaq::TaskControl::Response& res)
+{
+    WallTime start = WallTime::now();
+    std::map<std::string, Slot>::iterator it = slots.find(req.name);
+    if(it == slots.end()){
+        res.success = false;
+        res.message = "no group " + req.name;
+    }else{
+        it->second.group->pause();
+        drain(it->second);
+        res.success = true;
+        res.message = "stopped " + req.name;
+    }
+    res.latency_ms = msSince(start);
+    ROS_INFO("nidaqServer: stop %s: %s (%.1f ms)", req.name.c_str(), res.message.c_str(), res.latency_ms);
+    return true;
+}
+
+static bool retuneCallback(nidaq::RetuneTask::Request& req, nidaq::RetuneTask::Response& res)
+{
+    WallTime start = WallTime::now();
+    std::map<std::string, Slot>::iterator it = slots.find(req.name);
+    res.recreated = false;
+    if(it == slots.end()){
+        res.success = false;
+        res.message = "no group " + req.name;
+        res.latency_ms = msSince(start);
+        return true;
+    }
+
+    NodeHandle nh(*params, req.name);
+    bool co = (it->second.group->type() == "co");
+    setIf(nh, co ? "counter" : "channels", !req.channels.empty(), req.channels);
+    setIf(nh, co ? "frequency" : "rate", req.rate > 0, req.rate);
+    setIf(nh, "waveforms", !req.waveforms.empty(), req.waveforms);
+    setIf(nh, "amplitude", req.amplitude != 0, req.amplitude);
+    setIf(nh, "duty", req.duty > 0, req.duty);
+
+    bool wasRunning = it->second.group->running();
+    it->second.group->pause();
+    drain(it->second);
+    if(it->second.group->retune(nh)){
+        res.success = true;
+        res.message = "retuned " + req.name;
+    }else{
+        res.recreated = true;
+        removeGroup(req.name);
+        res.success = addGroup(req.name, &res.message);
+        it = slots.find(req.name);
+    }
+    if(res.success && wasRunning)
+        res.success = startGroup(it->second, &res.message);
+    res.latency_ms = msSince(start);
+    ROS_INFO("nidaqServer: retune %s%s: %s (%.1f ms)", req.name.c_str(), res.recreated ? " (new task)" : "", res.message.c_str(), res.latency_ms);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    init(argc, argv, "nidaqServer");
+    NodeHandle n;
+    NodeHandle pn("~");
+    topics = &n;
+    params = &pn;
+
+    std::vector<std::string> names;
+    bool        autostart;
+    std::string message;
+    pn.getParam("groups", names);
+    pn.param("autostart", autostart, true);
+
+    sem_init(&ready, 0, 0);
+    for(size_t g = 0; g < names.size(); g++){
+        if(!addGroup(names[g], &message))
+            ROS_ERROR("nidaqServer: %s", message.c_str());
+        else if(autostart && !startGroup(slots[names[g]], &message))
+            ROS_ERROR("nidaqServer: %s", message.c_str());
+    }
+
+    ServiceServer configure_srv = n.advertiseService("nidaqServer/configure", configureCallback);
+    ServiceServer start_srv = n.advertiseService("nidaqServer/start", startCallback);
+    ServiceServer stop_srv = n.advertiseService("nidaqServer/stop", stopCallback);
+    ServiceServer retune_srv = n.advertiseService("nidaqServer/retune", retuneCallback);
+    ROS_INFO("NIDAQmx Base server ready, %lu groups", (unsigned long)slots.size());
+
+    nidaq::daqDiagnostics diagnostics;
+    WallTime    lastReport = WallTime::now();
+    struct timespec deadline;
+
+    while(ok()){
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 100000000;
+        if(deadline.tv_nsec >= 1000000000){
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        while(sem_timedwait(&ready, &deadline) == -1 && errno == EINTR)
+            ;
+
+        for(std::map<std::string, Slot>::iterator it = slots.begin(); it != slots.end(); ++it){
+            drain(it->second);
+            if(it->second.group->failed() && !it->second.failReported){
+                // keep the task; a retune or start may bring it back
+                ROS_ERROR("nidaqServer: group %s failed and is stopped", it->first.c_str());
+                it->second.group->pause();
+                it->second.failReported = true;
+            }
+        }
+
+        WallTime now = WallTime::now();
+        if((now - lastReport).toSec() >= 1.0){
+            for(std::map<std::string, Slot>::iterator it = slots.begin(); it != slots.end(); ++it){
+                nidaq::fillDiagnostics(it->second.group->stats().recovery, &diagnostics);
+                it->second.diag_pub.publish(diagnostics);
+            }
+            lastReport = now;
+        }
+        spinOnce();     // the services run here, between two drains
+    }
+
+    for(std::map<std::string, Slot>::iterator it = slots.begin(); it != slots.end(); ++it){
+        it->second.group->stop();   // joins the thread before the group's members go
+        delete it->second.group;
+    }
+    sem_destroy(&ready);
+    return 0;
+}